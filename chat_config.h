@@ -0,0 +1,78 @@
+// A testcase's input.txt parsed once by app.c. The parsed block goes into a memfd that every
+// groups.out it spawns inherits; the fd number is the group's third argument.
+#ifndef CHAT_CONFIG_H
+#define CHAT_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#define CHAT_CONFIG_GROUPS 30     // same limit as MAX_GROUPS
+
+typedef struct{
+	int groups;
+	int keyValidation;
+	int keyApp;
+	int keyModerator;
+	int threshold;
+	int groupNumbers[CHAT_CONFIG_GROUPS]; // X of groups/group_X.txt, in input.txt order
+}ChatConfig;
+
+// Reads input.txt: no. of groups, the three queue keys, the threshold, then one group file per line
+static inline void parseChatConfig(const char *path, ChatConfig *config){
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		perror("Error opening file");
+		exit(1);
+	}
+	if (fscanf(file, "%d %d %d %d %d", &config->groups, &config->keyValidation, &config->keyApp,
+	           &config->keyModerator, &config->threshold) != 5) {
+		printf("Error reading %s\n", path);
+		exit(1);
+	}
+	if (config->groups > CHAT_CONFIG_GROUPS) {
+		printf("Can't create more than %d groups\n", CHAT_CONFIG_GROUPS);
+		exit(1);
+	}
+	char line[256];
+	for (int i = 0; i < config->groups; i++) {
+		if (fscanf(file, "%255s", line) != 1) {
+			printf("Error: group_id %d exceeds available groups.\n", i + 1);
+			exit(1);
+		}
+		if (sscanf(line, "groups/group_%d.txt", &config->groupNumbers[i]) != 1) {
+			printf("Failed to extract group number from %s\n", line);
+			exit(1);
+		}
+	}
+	fclose(file);
+}
+
+// Copies the block into a memfd left open across exec, and returns its fd
+static inline int shareChatConfig(const ChatConfig *config){
+	int fd = syscall(SYS_memfd_create, "chat_config", 0);
+	if (fd == -1) {
+		perror("memfd_create failed");
+		exit(1);
+	}
+	if (write(fd, config, sizeof(ChatConfig)) != sizeof(ChatConfig)) {
+		perror("Error writing configuration");
+		exit(1);
+	}
+	return fd;
+}
+
+static inline const ChatConfig *attachChatConfig(int fd){
+	const ChatConfig *config = (const ChatConfig *)mmap(NULL, sizeof(ChatConfig), PROT_READ, MAP_SHARED, fd, 0);
+	if (config == MAP_FAILED) {
+		perror("mmap failed");
+		exit(1);
+	}
+	close(fd);
+	return config;
+}
+
+#endif
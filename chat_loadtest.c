@@ -0,0 +1,875 @@
+// Load test for the chat system (app.c, groups.c, moderator.c).
+//
+// generate writes a testcase_N tree: input.txt, filtered_words.txt, one groups/group_X.txt per
+// group and one users/user_X_Y.txt per user. Timestamps are distinct within a group; interleave 0
+// gives every user one long run of the group's timeline, 1 mixes all users' messages at random.
+// A message has a filtered word with probability --hit-rate.
+//
+// validate stands in for validation.out on the validation queue of testcase_N in the current
+// directory. It replays the chat rules on the testcase files (a group sends its users' messages in
+// timestamp order while two or more users are left, and a user goes once its filtered word count
+// reaches the threshold), checks every group, user and chat message against that, and reports
+// throughput and per-message latency. Every message of a user is in its file from the start, so
+// its latency runs from when the group opened that user's stream (the user created message it
+// sends right after) to when the message reached validation.
+//
+// run does both around the real programs: it generates a testcase in a scratch directory, starts
+// moderator.out and app.out from <bin-dir> there (only app.out with --threaded, for an app.out
+// built with -DCHAT_THREADS) and validates the run.
+//
+// Usage: chat_loadtest generate <dir> [workload options] [--testcase N] [--key N]
+//        chat_loadtest validate <testcase> [--timeout N]
+//        chat_loadtest run <bin-dir> [workload options] [--workers N] [--threaded] [--keep]
+//                                    [--timeout N]
+// Workload options: [--groups N] [--users N] [--messages N] [--interleave F] [--min-text N]
+//                   [--max-text N] [--hit-rate F] [--words N] [--threshold N] [--seed N]
+// --users is per group and --messages per user. CHAT_TRANSPORT and CHAT_USER_STREAMS are passed
+// on to the programs as set.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <ctype.h>
+#include <time.h>
+#include <signal.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+
+#define MAX_GROUPS 30
+#define MAX_USERS 50
+#define MAX_TEXT_SIZE 256
+#define MAX_LOAD_TEXT 240          // text + timestamp still fit the 255 bytes a user reads per line
+#define MAX_FILTERED_WORDS 50
+#define MAX_REPORTED_ERRORS 10
+#define DEFAULT_TIMEOUT_SECONDS 120
+
+// Wire format shared with groups.c and validation.out
+typedef struct{
+    long mtype;
+    int timestamp;
+    int user;
+    char mtext[MAX_TEXT_SIZE];
+    int modifyingGroup;
+} Message;
+
+typedef struct LoadConfig {
+    int groups;
+    int users;          // per group
+    int messages;       // per user
+    double interleave;
+    int minText;
+    int maxText;
+    double hitRate;
+    int words;
+    int threshold;
+    unsigned long long seed;
+} LoadConfig;
+
+// Small deterministic generator, so a seed always gives the same testcase
+unsigned long long rngState;
+
+unsigned int nextRandom() {
+    rngState = rngState * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (unsigned int)(rngState >> 33);
+}
+
+int randomBetween(int low, int high) {
+    return low + (int)(nextRandom() % (unsigned int)(high - low + 1));
+}
+
+double randomUnit() {
+    return nextRandom() / 4294967296.0;
+}
+
+double secondsNow() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+FILE *openForWriting(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        perror(path);
+        exit(1);
+    }
+    return file;
+}
+
+void makeDirectory(const char *path) {
+    if (mkdir(path, 0755) == -1 && errno != EEXIST) {
+        perror(path);
+        exit(1);
+    }
+}
+
+// A random text of `length` bytes: mixed-case letters in '_'-separated words, and a filtered word
+// somewhere in it (in random case) when `word` is given
+void randomText(char *text, int length, const char *word) {
+    int wordLeft = randomBetween(2, 8);
+    for (int i = 0; i < length; i++) {
+        if (wordLeft-- == 0 && i > 0 && i < length - 1) {
+            text[i] = '_';
+            wordLeft = randomBetween(2, 8);
+            continue;
+        }
+        int letter = randomBetween(0, 51);
+        text[i] = letter < 26 ? 'a' + letter : 'A' + letter - 26;
+    }
+    text[length] = '\0';
+    if (word != NULL) {
+        int wordLength = strlen(word);
+        int at = randomBetween(0, length - wordLength);
+        for (int i = 0; i < wordLength; i++) {
+            text[at + i] = randomBetween(0, 1) ? toupper((unsigned char)word[i]) : word[i];
+        }
+    }
+}
+
+void generateTestcase(const char *dir, int testcase, const LoadConfig *config, key_t base) {
+    rngState = config->seed * 2654435761ULL + 1;
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/testcase_%d", dir, testcase);
+    makeDirectory(path);
+    snprintf(path, sizeof(path), "%s/testcase_%d/groups", dir, testcase);
+    makeDirectory(path);
+    snprintf(path, sizeof(path), "%s/testcase_%d/users", dir, testcase);
+    makeDirectory(path);
+
+    char words[MAX_FILTERED_WORDS][9];
+    snprintf(path, sizeof(path), "%s/testcase_%d/filtered_words.txt", dir, testcase);
+    FILE *file = openForWriting(path);
+    for (int w = 0; w < config->words; w++) {
+        int length = randomBetween(3, 8);
+        for (int i = 0; i < length; i++) {
+            words[w][i] = 'a' + randomBetween(0, 25);
+        }
+        words[w][length] = '\0';
+        fprintf(file, "%s\n", words[w]);
+    }
+    fclose(file);
+
+    snprintf(path, sizeof(path), "%s/testcase_%d/input.txt", dir, testcase);
+    file = openForWriting(path);
+    fprintf(file, "%d\n%d\n%d\n%d\n%d\n", config->groups, (int)base, (int)(base + 1), (int)(base + 2),
+            config->threshold);
+    for (int g = 0; g < config->groups; g++) {
+        fprintf(file, "groups/group_%d.txt\n", g);
+    }
+    fclose(file);
+
+    int total = config->users * config->messages;
+    int *owners = (int *)malloc(total * sizeof(int));
+    FILE **userFiles = (FILE **)malloc(config->users * sizeof(FILE *));
+    if (owners == NULL || userFiles == NULL) {
+        perror("Memory allocation failed for testcase");
+        exit(1);
+    }
+    for (int g = 0; g < config->groups; g++) {
+        snprintf(path, sizeof(path), "%s/testcase_%d/groups/group_%d.txt", dir, testcase, g);
+        file = openForWriting(path);
+        fprintf(file, "%d\n", config->users);
+        for (int u = 0; u < config->users; u++) {
+            fprintf(file, "users/user_%d_%d.txt\n", g, u);
+            snprintf(path, sizeof(path), "%s/testcase_%d/users/user_%d_%d.txt", dir, testcase, g, u);
+            userFiles[u] = openForWriting(path);
+        }
+        fclose(file);
+
+        // The group's timeline in user runs, with a share of its slots swapped between users
+        for (int i = 0; i < total; i++) {
+            owners[i] = i / config->messages;
+        }
+        for (int i = 0; i < total; i++) {
+            if (randomUnit() < config->interleave) {
+                int j = randomBetween(0, total - 1);
+                int owner = owners[i];
+                owners[i] = owners[j];
+                owners[j] = owner;
+            }
+        }
+        int timestamp = 0;
+        char text[MAX_LOAD_TEXT + 1];
+        for (int i = 0; i < total; i++) {
+            timestamp += randomBetween(1, 10);
+            const char *word = (config->words > 0 && randomUnit() < config->hitRate)
+                               ? words[randomBetween(0, config->words - 1)] : NULL;
+            int length = randomBetween(config->minText, config->maxText);
+            if (word != NULL && length < (int)strlen(word)) {
+                length = strlen(word);
+            }
+            randomText(text, length, word);
+            fprintf(userFiles[owners[i]], "%d %s\n", timestamp, text);
+        }
+        for (int u = 0; u < config->users; u++) {
+            fclose(userFiles[u]);
+        }
+    }
+    free(owners);
+    free(userFiles);
+}
+
+// What validation.out should see from one group
+typedef struct ExpectedMessage {
+    int user;
+    int timestamp;
+    char *text;
+} ExpectedMessage;
+
+typedef struct ExpectedGroup {
+    int number;             // X of group_X.txt
+    int numUsers;
+    int users[MAX_USERS];   // Y of each user_X_Y.txt
+    ExpectedMessage *messages;
+    int numMessages;
+    int violatingUsers;
+
+    // filled in while validating
+    bool created;
+    bool terminated;
+    bool userCreated[MAX_USERS];
+    double userCreatedAt[MAX_USERS]; // when the user created message arrived
+    int received;
+    double createdAt;
+} ExpectedGroup;
+
+typedef struct Testcase {
+    int numGroups;
+    key_t validationKey;
+    key_t appKey;
+    key_t moderatorKey;
+    int threshold;
+    char *words[MAX_FILTERED_WORDS];
+    int numWords;
+    ExpectedGroup groups[MAX_GROUPS];
+    long long totalMessages;
+} Testcase;
+
+// A user's messages as groups.c reads them: fgets of up to 255 bytes, then "%d %s"
+typedef struct UserMessages {
+    ExpectedMessage *messages;
+    int count;
+    int next;
+    int violations;
+} UserMessages;
+
+void readUserFile(const char *path, int user, UserMessages *out) {
+    out->messages = NULL;
+    out->count = out->next = out->violations = 0;
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return; // the user process exits without sending anything
+    }
+    int capacity = 0;
+    char line[MAX_TEXT_SIZE], text[MAX_TEXT_SIZE];
+    int timestamp;
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "%d %s", &timestamp, text) != 2) {
+            continue;
+        }
+        if (out->count == capacity) {
+            capacity = capacity ? 2 * capacity : 64;
+            out->messages = (ExpectedMessage *)realloc(out->messages, capacity * sizeof(ExpectedMessage));
+            if (out->messages == NULL) {
+                perror("Memory allocation failed for user messages");
+                exit(1);
+            }
+        }
+        out->messages[out->count].user = user;
+        out->messages[out->count].timestamp = timestamp;
+        out->messages[out->count].text = strdup(text);
+        out->count++;
+    }
+    fclose(file);
+}
+
+int countFilteredWords(const Testcase *testcase, const char *text) {
+    char lowered[MAX_TEXT_SIZE];
+    int i = 0;
+    for (; text[i] != '\0' && i < MAX_TEXT_SIZE - 1; i++) {
+        lowered[i] = tolower((unsigned char)text[i]);
+    }
+    lowered[i] = '\0';
+    int count = 0;
+    for (int w = 0; w < testcase->numWords; w++) {
+        for (const char *p = lowered; (p = strstr(p, testcase->words[w])) != NULL; p++) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// One message at a time, the oldest head first, as the original groups.c and moderator.c did
+void replayGroup(Testcase *testcase, ExpectedGroup *group, UserMessages *users) {
+    int capacity = 0;
+    for (int u = 0; u < group->numUsers; u++) {
+        capacity += users[u].count;
+    }
+    group->messages = (ExpectedMessage *)malloc((capacity > 0 ? capacity : 1) * sizeof(ExpectedMessage));
+    if (group->messages == NULL) {
+        perror("Memory allocation failed for expected messages");
+        exit(1);
+    }
+
+    bool active[MAX_USERS];
+    int activeUsers = group->numUsers;
+    for (int u = 0; u < group->numUsers; u++) {
+        active[u] = users[u].count > 0;
+        if (!active[u]) {
+            activeUsers--;
+        }
+    }
+    while (activeUsers >= 2) {
+        int next = -1;
+        for (int u = 0; u < group->numUsers; u++) {
+            if (active[u] && (next == -1 ||
+                users[u].messages[users[u].next].timestamp < users[next].messages[users[next].next].timestamp ||
+                (users[u].messages[users[u].next].timestamp == users[next].messages[users[next].next].timestamp &&
+                 group->users[u] < group->users[next]))) {
+                next = u;
+            }
+        }
+        UserMessages *user = &users[next];
+        ExpectedMessage *message = &user->messages[user->next++];
+        group->messages[group->numMessages++] = *message;
+
+        user->violations += countFilteredWords(testcase, message->text);
+        if (user->violations >= testcase->threshold) {
+            active[next] = false;
+            activeUsers--;
+            group->violatingUsers++;
+        } else if (user->next == user->count) {
+            active[next] = false;
+            activeUsers--;
+        }
+    }
+    testcase->totalMessages += group->numMessages;
+}
+
+void loadTestcase(Testcase *testcase, int number) {
+    memset(testcase, 0, sizeof(Testcase));
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "testcase_%d/input.txt", number);
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        exit(1);
+    }
+    int validationKey, appKey, moderatorKey;
+    if (fscanf(file, "%d %d %d %d %d", &testcase->numGroups, &validationKey, &appKey, &moderatorKey,
+               &testcase->threshold) != 5 || testcase->numGroups < 0 || testcase->numGroups > MAX_GROUPS) {
+        fprintf(stderr, "Error reading %s\n", path);
+        exit(1);
+    }
+    testcase->validationKey = validationKey;
+    testcase->appKey = appKey;
+    testcase->moderatorKey = moderatorKey;
+    char line[PATH_MAX];
+    for (int g = 0; g < testcase->numGroups; g++) {
+        if (fscanf(file, "%255s", line) != 1 ||
+            sscanf(line, "groups/group_%d.txt", &testcase->groups[g].number) != 1) {
+            fprintf(stderr, "Error reading group %d of %s\n", g + 1, path);
+            exit(1);
+        }
+    }
+    fclose(file);
+
+    snprintf(path, sizeof(path), "testcase_%d/filtered_words.txt", number);
+    file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        exit(1);
+    }
+    while (testcase->numWords < MAX_FILTERED_WORDS && fscanf(file, "%255s", line) == 1) {
+        for (char *c = line; *c != '\0'; c++) {
+            *c = tolower((unsigned char)*c);
+        }
+        testcase->words[testcase->numWords++] = strdup(line);
+    }
+    fclose(file);
+
+    for (int g = 0; g < testcase->numGroups; g++) {
+        ExpectedGroup *group = &testcase->groups[g];
+        snprintf(path, sizeof(path), "testcase_%d/groups/group_%d.txt", number, group->number);
+        file = fopen(path, "r");
+        if (file == NULL || fscanf(file, "%d", &group->numUsers) != 1 ||
+            group->numUsers < 0 || group->numUsers > MAX_USERS) {
+            fprintf(stderr, "Error reading %s\n", path);
+            exit(1);
+        }
+        UserMessages users[MAX_USERS];
+        for (int u = 0; u < group->numUsers; u++) {
+            int x;
+            if (fscanf(file, "%255s", line) != 1 ||
+                sscanf(line, "users/user_%d_%d.txt", &x, &group->users[u]) != 2) {
+                fprintf(stderr, "Error reading user %d of %s\n", u + 1, path);
+                exit(1);
+            }
+            char userPath[PATH_MAX + 16];
+            snprintf(userPath, sizeof(userPath), "testcase_%d/%s", number, line);
+            readUserFile(userPath, group->users[u], &users[u]);
+        }
+        fclose(file);
+
+        replayGroup(testcase, group, users);
+        for (int u = 0; u < group->numUsers; u++) {
+            for (int i = users[u].next; i < users[u].count; i++) {
+                free(users[u].messages[i].text); // never sent
+            }
+            free(users[u].messages);
+        }
+    }
+}
+
+ExpectedGroup *findGroup(Testcase *testcase, int number) {
+    for (int g = 0; g < testcase->numGroups; g++) {
+        if (testcase->groups[g].number == number) {
+            return &testcase->groups[g];
+        }
+    }
+    return NULL;
+}
+
+int findUser(const ExpectedGroup *group, int user) {
+    for (int u = 0; u < group->numUsers; u++) {
+        if (group->users[u] == user) {
+            return u;
+        }
+    }
+    return -1;
+}
+
+typedef struct ValidationResult {
+    bool completed;         // every group terminated
+    long long received;     // chat messages
+    long long errors;
+    double firstCreated;
+    double lastTerminated;
+    double *latencies;      // seconds from user created to arrival, one per received chat message
+} ValidationResult;
+
+void reportError(ValidationResult *result, const char *format, int a, int b, int c) {
+    if (result->errors++ < MAX_REPORTED_ERRORS) {
+        fprintf(stderr, "Validation error: ");
+        fprintf(stderr, format, a, b, c);
+        fprintf(stderr, "\n");
+    }
+}
+
+// Checks one message from a group; returns true once every group has terminated
+bool checkMessage(Testcase *testcase, const Message *message, double now, ValidationResult *result) {
+    static int terminatedGroups = 0;
+    if (message->mtype >= 1 && message->mtype <= 3) {
+        ExpectedGroup *group = findGroup(testcase, message->modifyingGroup);
+        if (group == NULL) {
+            reportError(result, "message type %d from unknown group %d", (int)message->mtype, message->modifyingGroup, 0);
+            return false;
+        }
+        if (message->mtype == 1) {
+            if (group->created) {
+                reportError(result, "group %d created twice", group->number, 0, 0);
+            }
+            group->created = true;
+            group->createdAt = now;
+            if (result->firstCreated == 0) {
+                result->firstCreated = now;
+            }
+        } else if (message->mtype == 2) {
+            int u = findUser(group, message->user);
+            if (u == -1 || group->userCreated[u]) {
+                reportError(result, "unexpected user %d created in group %d", message->user, group->number, 0);
+            } else {
+                group->userCreated[u] = true;
+                group->userCreatedAt[u] = now;
+            }
+        } else {
+            if (!group->created || group->terminated) {
+                reportError(result, "group %d terminated while not running", group->number, 0, 0);
+            }
+            if (group->received != group->numMessages) {
+                reportError(result, "group %d terminated after %d of %d messages", group->number,
+                            group->received, group->numMessages);
+            }
+            if (message->user != group->violatingUsers) {
+                reportError(result, "group %d reported %d violating users, expected %d", group->number,
+                            message->user, group->violatingUsers);
+            }
+            group->terminated = true;
+            result->lastTerminated = now;
+            return ++terminatedGroups == testcase->numGroups;
+        }
+        return false;
+    }
+
+    ExpectedGroup *group = findGroup(testcase, (int)message->mtype - MAX_GROUPS);
+    if (group == NULL || !group->created || group->terminated) {
+        reportError(result, "chat message of type %d outside a running group", (int)message->mtype, 0, 0);
+        return false;
+    }
+    int u = findUser(group, message->user);
+    if (u != -1 && !group->userCreated[u]) {
+        reportError(result, "group %d sent a message of user %d before the user was created", group->number, message->user, 0);
+    }
+    double start = u != -1 && group->userCreated[u] ? group->userCreatedAt[u] : group->createdAt;
+    if (group->received == group->numMessages) {
+        reportError(result, "group %d sent more than its %d messages", group->number, group->numMessages, 0);
+        return false;
+    }
+    ExpectedMessage *expected = &group->messages[group->received++];
+    if (expected->user != message->user || expected->timestamp != message->timestamp ||
+        strncmp(expected->text, message->mtext, MAX_TEXT_SIZE) != 0) {
+        reportError(result, "group %d message %d differs (timestamp %d)", group->number, group->received,
+                    message->timestamp);
+    }
+    result->latencies[result->received++] = now - start;
+    return false;
+}
+
+volatile sig_atomic_t validationTimedOut = 0;
+
+void interruptValidation(int signum) {
+    if (signum == SIGALRM) {
+        validationTimedOut = 1;
+    }
+}
+
+// Reads the validation queue until every group has terminated, the timeout passes or, when app is
+// given, app.out has exited and the queue is empty (groups message validation before app.out)
+ValidationResult validateRun(Testcase *testcase, int queueId, pid_t app, int timeoutSeconds) {
+    ValidationResult result;
+    memset(&result, 0, sizeof(result));
+    result.latencies = (double *)malloc((testcase->totalMessages + 1) * sizeof(double));
+    if (result.latencies == NULL) {
+        perror("Memory allocation failed for latencies");
+        exit(1);
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = interruptValidation; // no SA_RESTART, so a blocked msgrcv returns
+    sigaction(SIGALRM, &action, NULL);
+    sigaction(SIGCHLD, &action, NULL);
+    alarm(timeoutSeconds);
+
+    bool appExited = false;
+    Message message;
+    while (!result.completed) {
+        if (msgrcv(queueId, &message, sizeof(Message) - sizeof(long), 0, appExited ? IPC_NOWAIT : 0) == -1) {
+            if (errno != EINTR) {
+                break; // ENOMSG once app.out is gone, or the queue was removed
+            }
+            if (validationTimedOut) {
+                fprintf(stderr, "Validation timed out after %d seconds\n", timeoutSeconds);
+                break;
+            }
+            if (app > 0 && waitpid(app, NULL, WNOHANG) == app) {
+                appExited = true;
+            }
+            continue;
+        }
+        result.completed = checkMessage(testcase, &message, secondsNow(), &result);
+    }
+    alarm(0);
+    if (!result.completed) {
+        for (int g = 0; g < testcase->numGroups; g++) {
+            if (!testcase->groups[g].terminated) {
+                reportError(&result, "group %d never terminated (%d of %d messages)", testcase->groups[g].number,
+                            testcase->groups[g].received, testcase->groups[g].numMessages);
+            }
+        }
+    }
+    return result;
+}
+
+int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+void printReport(const Testcase *testcase, ValidationResult *result) {
+    double seconds = result->lastTerminated - result->firstCreated;
+    printf("%lld of %lld messages validated, %lld errors%s\n", result->received, testcase->totalMessages,
+           result->errors, result->completed ? "" : ", run incomplete");
+    if (result->received == 0 || seconds <= 0) {
+        return;
+    }
+    qsort(result->latencies, result->received, sizeof(double), compareDoubles);
+    double percentiles[] = {0.50, 0.90, 0.99};
+    printf("%.3f s from first group created to last group terminated, %.0f messages/s\n",
+           seconds, result->received / seconds);
+    printf("latency from user created (us):");
+    for (int p = 0; p < 3; p++) {
+        long long index = (long long)(percentiles[p] * (result->received - 1));
+        printf(" p%.0f %.1f", percentiles[p] * 100, result->latencies[index] * 1e6);
+    }
+    printf(" max %.1f\n", result->latencies[result->received - 1] * 1e6);
+}
+
+// Creates the three queues of a run under keys nobody else is using
+bool createRunQueues(key_t base, int *queueIds) {
+    for (int i = 0; i < 3; i++) {
+        queueIds[i] = msgget(base + i, 0666 | IPC_CREAT | IPC_EXCL);
+        if (queueIds[i] == -1) {
+            for (int j = 0; j < i; j++) {
+                msgctl(queueIds[j], IPC_RMID, NULL);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+pid_t startProgram(const char *dir, const char *log, char *const args[]) {
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("Error forking");
+        exit(1);
+    }
+    if (pid == 0) {
+        if (chdir(dir) == -1) {
+            _exit(127);
+        }
+        int logFd = open(log, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (logFd != -1) {
+            dup2(logFd, STDOUT_FILENO);
+            dup2(logFd, STDERR_FILENO);
+        }
+        execv(args[0], args);
+        _exit(127);
+    }
+    return pid;
+}
+
+int removeEntry(const char *path, const struct stat *status, int type, struct FTW *ftw) {
+    (void)status; (void)type; (void)ftw;
+    return remove(path);
+}
+
+bool parseLoadOption(const char *option, const char *value, LoadConfig *config) {
+    if (strcmp(option, "--groups") == 0) {
+        config->groups = atoi(value);
+    } else if (strcmp(option, "--users") == 0) {
+        config->users = atoi(value);
+    } else if (strcmp(option, "--messages") == 0) {
+        config->messages = atoi(value);
+    } else if (strcmp(option, "--interleave") == 0) {
+        config->interleave = atof(value);
+    } else if (strcmp(option, "--min-text") == 0) {
+        config->minText = atoi(value);
+    } else if (strcmp(option, "--max-text") == 0) {
+        config->maxText = atoi(value);
+    } else if (strcmp(option, "--hit-rate") == 0) {
+        config->hitRate = atof(value);
+    } else if (strcmp(option, "--words") == 0) {
+        config->words = atoi(value);
+    } else if (strcmp(option, "--threshold") == 0) {
+        config->threshold = atoi(value);
+    } else if (strcmp(option, "--seed") == 0) {
+        config->seed = strtoull(value, NULL, 10);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool loadConfigIsValid(const LoadConfig *config) {
+    if (config->groups < 1 || config->groups > MAX_GROUPS || config->users < 1 || config->users > MAX_USERS ||
+        config->messages < 0 || (long long)config->users * config->messages * 10 >= 2147000000LL ||
+        config->minText < 1 || config->maxText < config->minText || config->maxText > MAX_LOAD_TEXT ||
+        config->words < 0 || config->words > MAX_FILTERED_WORDS) {
+        fprintf(stderr, "Groups must be 1-%d, users 1-%d, texts 1-%d bytes and words 0-%d, "
+                        "and a group's timestamps must stay below 2147000000\n",
+                MAX_GROUPS, MAX_USERS, MAX_LOAD_TEXT, MAX_FILTERED_WORDS);
+        return false;
+    }
+    return true;
+}
+
+void usage(const char *program) {
+    fprintf(stderr, "Usage: %s generate <dir> [workload options] [--testcase N] [--key N]\n"
+                    "       %s validate <testcase> [--timeout N]\n"
+                    "       %s run <bin-dir> [workload options] [--workers N] [--threaded] [--keep] [--timeout N]\n"
+                    "Workload options: [--groups N] [--users N] [--messages N] [--interleave F] [--min-text N]\n"
+                    "                  [--max-text N] [--hit-rate F] [--words N] [--threshold N] [--seed N]\n",
+            program, program, program);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *command = argv[1];
+    LoadConfig config = { 4, 8, 200, 0.5, 4, 40, 0.05, 10, 5, 1 };
+    int testcaseNumber = 1;
+    key_t key = 0;
+    int timeoutSeconds = DEFAULT_TIMEOUT_SECONDS;
+    int workers = 0;
+    bool threaded = false;
+    bool keep = false;
+
+    for (int i = 3; i < argc; i++) {
+        const char *option = argv[i];
+        if (strcmp(option, "--threaded") == 0) {
+            threaded = true;
+            continue;
+        }
+        if (strcmp(option, "--keep") == 0) {
+            keep = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", option);
+            return 1;
+        }
+        const char *value = argv[++i];
+        if (parseLoadOption(option, value, &config)) {
+            continue;
+        } else if (strcmp(option, "--testcase") == 0) {
+            testcaseNumber = atoi(value);
+        } else if (strcmp(option, "--key") == 0) {
+            key = (key_t)atoi(value);
+        } else if (strcmp(option, "--timeout") == 0) {
+            timeoutSeconds = atoi(value);
+        } else if (strcmp(option, "--workers") == 0) {
+            workers = atoi(value);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", option);
+            return 1;
+        }
+    }
+
+    if (strcmp(command, "generate") == 0) {
+        if (!loadConfigIsValid(&config)) {
+            return 1;
+        }
+        if (key == 0) {
+            key = 0x43000000 + (key_t)(config.seed % 0x100000) * 4;
+        }
+        makeDirectory(argv[2]);
+        generateTestcase(argv[2], testcaseNumber, &config, key);
+        printf("Wrote %s/testcase_%d (queue keys %d, %d, %d)\n", argv[2], testcaseNumber,
+               (int)key, (int)key + 1, (int)key + 2);
+        return 0;
+    }
+
+    if (strcmp(command, "validate") == 0) {
+        Testcase *testcase = (Testcase *)malloc(sizeof(Testcase));
+        if (testcase == NULL) {
+            perror("Memory allocation failed for testcase");
+            return 1;
+        }
+        loadTestcase(testcase, atoi(argv[2]));
+        int queueId = msgget(testcase->validationKey, 0666 | IPC_CREAT);
+        if (queueId == -1) {
+            perror("msgget failed");
+            return 1;
+        }
+        ValidationResult result = validateRun(testcase, queueId, 0, timeoutSeconds);
+        printReport(testcase, &result);
+        msgctl(queueId, IPC_RMID, NULL);
+        return result.completed && result.errors == 0 ? 0 : 1;
+    }
+
+    if (strcmp(command, "run") != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!loadConfigIsValid(&config)) {
+        return 1;
+    }
+    char binDir[PATH_MAX];
+    if (realpath(argv[2], binDir) == NULL) {
+        perror("Error resolving binary directory");
+        return 1;
+    }
+    const char *programs[] = { "app.out", "groups.out", "moderator.out" };
+    int numPrograms = threaded ? 1 : 3;
+    char programPaths[3][PATH_MAX + 16];
+    for (int p = 0; p < numPrograms; p++) {
+        snprintf(programPaths[p], sizeof(programPaths[p]), "%s/%s", binDir, programs[p]);
+        if (access(programPaths[p], X_OK) == -1) {
+            perror(programPaths[p]);
+            return 1;
+        }
+    }
+
+    int queueIds[3];
+    for (int attempt = 0; ; attempt++) {
+        key = 0x43000000 + (key_t)((getpid() * 97 + attempt * 7919) % 0x100000) * 4;
+        if (createRunQueues(key, queueIds)) {
+            break;
+        }
+        if (attempt == 99) {
+            perror("Error creating run queues");
+            return 1;
+        }
+    }
+
+    char dir[] = "/tmp/chatloadXXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        perror("Error creating run directory");
+        return 1;
+    }
+    generateTestcase(dir, 1, &config, key);
+    char linkPath[PATH_MAX];
+    for (int p = 0; p < numPrograms; p++) {
+        snprintf(linkPath, sizeof(linkPath), "%s/%s", dir, programs[p]);
+        if (symlink(programPaths[p], linkPath) == -1) {
+            perror("Error linking program into run directory");
+            return 1;
+        }
+    }
+    if (chdir(dir) == -1) {
+        perror("Error entering run directory");
+        return 1;
+    }
+    Testcase *testcase = (Testcase *)malloc(sizeof(Testcase));
+    if (testcase == NULL) {
+        perror("Memory allocation failed for testcase");
+        return 1;
+    }
+    loadTestcase(testcase, 1);
+    printf("%d groups x %d users x %d messages, %lld messages expected at validation\n",
+           config.groups, config.users, config.messages, testcase->totalMessages);
+
+    pid_t moderator = -1;
+    if (!threaded) {
+        char workerArg[20];
+        snprintf(workerArg, sizeof(workerArg), "%d", workers);
+        char *moderatorArgs[] = { "./moderator.out", "1", workers > 0 ? workerArg : NULL, NULL };
+        moderator = startProgram(dir, "moderator.log", moderatorArgs);
+    }
+    char *appArgs[] = { "./app.out", "1", NULL };
+    pid_t app = startProgram(dir, "app.log", appArgs);
+
+    ValidationResult result = validateRun(testcase, queueIds[0], app, timeoutSeconds);
+    printReport(testcase, &result);
+
+    kill(app, SIGKILL);
+    waitpid(app, NULL, 0);
+    if (moderator > 0) {
+        if (!result.completed) {
+            kill(moderator, SIGKILL);
+        }
+        waitpid(moderator, NULL, 0);
+    }
+    for (int i = 0; i < 3; i++) {
+        msgctl(queueIds[i], IPC_RMID, NULL);
+    }
+    if (keep) {
+        printf("Run directory kept: %s\n", dir);
+    } else {
+        nftw(dir, removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+    }
+    return result.completed && result.errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+// Shared-memory transport between groups.c and moderator.c, used instead of the moderator
+// message queue when CHAT_TRANSPORT=shm is set for app.out and moderator.out.
+//
+// Every group X gets two single-producer/single-consumer rings in one POSIX shared memory
+// segment: frames to the moderator and verdicts back. The moderator creates the segment afresh on
+// start and removes it on exit; groups wait for it. A side that finds its ring empty spins
+// briefly and then sleeps on a futex doorbell; the moderator has one doorbell for all groups.
+#ifndef CHAT_RING_H
+#define CHAT_RING_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define CHAT_RING_GROUPS 30       // group ids 0..29, same limit as the message queue mtypes
+#define CHAT_RING_SLOTS 4         // a group has at most one frame in flight, plus its termination
+#define CHAT_RING_SLOT_BYTES 8192 // largest frame, mtype included
+#define CHAT_RING_SPINS 2000      // empty polls before sleeping on the doorbell (multi-core only)
+#define CHAT_RING_ATTACH_DELAY_US 1000 // a group's wait between looks for the moderator's segment
+
+typedef struct{
+	_Atomic uint32_t seq;     // bumped after every push
+	_Atomic uint32_t waiters; // sleepers, so pushes skip the wake syscall when nobody waits
+}__attribute__((aligned(64))) ChatDoorbell;
+
+typedef struct{
+	_Atomic uint32_t head __attribute__((aligned(64))); // next slot to write, producer only
+	_Atomic uint32_t tail __attribute__((aligned(64))); // next slot to read, consumer only
+	uint32_t sizes[CHAT_RING_SLOTS] __attribute__((aligned(64)));
+	char slots[CHAT_RING_SLOTS][CHAT_RING_SLOT_BYTES];
+}ChatRing;
+
+typedef struct{
+	_Atomic int32_t moderatorPid; // set once the moderator has created the segment and serves it
+	ChatDoorbell moderatorBell;
+	struct{
+		ChatRing toModerator;
+		ChatRing toGroup;
+		ChatDoorbell groupBell;
+	}groups[CHAT_RING_GROUPS];
+}ChatRings;
+
+// 1 if CHAT_TRANSPORT=shm
+static inline int chatRingsSelected(void){
+	const char *transport = getenv("CHAT_TRANSPORT");
+	return transport != NULL && strcmp(transport, "shm") == 0;
+}
+
+static inline void chatRingsName(char *name, size_t size, int key){
+	snprintf(name, size, "/chat_rings_%d", key);
+}
+
+static inline ChatRings *mapChatRings(int fd){
+	ChatRings *rings = (ChatRings *)mmap(NULL, sizeof(ChatRings), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (rings == MAP_FAILED) {
+		perror("mmap failed");
+		exit(1);
+	}
+	close(fd);
+	return rings;
+}
+
+// Moderator side: replaces any segment a crashed run left behind with a zeroed one, then marks it
+// as served by this process
+static inline ChatRings *createChatRings(int key){
+	char name[64];
+	chatRingsName(name, sizeof(name), key);
+	shm_unlink(name);
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0666);
+	if (fd == -1) {
+		perror("shm_open failed");
+		exit(1);
+	}
+	if (ftruncate(fd, sizeof(ChatRings)) == -1) {
+		perror("ftruncate failed");
+		exit(1);
+	}
+	ChatRings *rings = mapChatRings(fd);
+	atomic_store(&rings->moderatorPid, (int32_t)getpid());
+	return rings;
+}
+
+// Group side: waits for the moderator's segment. A segment whose moderator is gone was left by an
+// earlier run and is about to be replaced, so it is dropped and opened again.
+static inline ChatRings *attachChatRings(int key){
+	char name[64];
+	chatRingsName(name, sizeof(name), key);
+	while (1) {
+		int fd = shm_open(name, O_RDWR, 0666);
+		if (fd == -1) {
+			if (errno != ENOENT) {
+				perror("shm_open failed");
+				exit(1);
+			}
+			usleep(CHAT_RING_ATTACH_DELAY_US);
+			continue;
+		}
+		struct stat st;
+		if (fstat(fd, &st) == -1) {
+			perror("fstat failed");
+			exit(1);
+		}
+		if (st.st_size < (off_t)sizeof(ChatRings)) {
+			close(fd);
+			usleep(CHAT_RING_ATTACH_DELAY_US);
+			continue;
+		}
+		ChatRings *rings = mapChatRings(fd);
+		int32_t pid;
+		while ((pid = atomic_load(&rings->moderatorPid)) == 0)
+			usleep(CHAT_RING_ATTACH_DELAY_US);
+		if (kill(pid, 0) == 0 || errno == EPERM)
+			return rings;
+		munmap(rings, sizeof(ChatRings));
+		usleep(CHAT_RING_ATTACH_DELAY_US);
+	}
+}
+
+static inline void removeChatRings(int key){
+	char name[64];
+	chatRingsName(name, sizeof(name), key);
+	shm_unlink(name);
+}
+
+// Polls an empty ring may take before sleeping; on one CPU the other side cannot run while we spin
+static inline int chatRingSpinLimit(void){
+	static int limit = -1;
+	if (limit < 0)
+		limit = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? CHAT_RING_SPINS : 0;
+	return limit;
+}
+
+static inline void chatRingRelax(void){
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+static inline void chatDoorbellRing(ChatDoorbell *bell){
+	atomic_fetch_add(&bell->seq, 1);
+	if (atomic_load(&bell->waiters) > 0)
+		syscall(SYS_futex, &bell->seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+// Arm before the last emptiness check, so a push after it changes seq and the wait returns at once
+static inline uint32_t chatDoorbellArm(ChatDoorbell *bell){
+	uint32_t seen = atomic_load(&bell->seq);
+	atomic_fetch_add(&bell->waiters, 1);
+	return seen;
+}
+
+static inline void chatDoorbellWait(ChatDoorbell *bell, uint32_t seen, int ready){
+	if (!ready)
+		syscall(SYS_futex, &bell->seq, FUTEX_WAIT, seen, NULL, NULL, 0);
+	atomic_fetch_sub(&bell->waiters, 1);
+}
+
+static inline int chatRingEmpty(ChatRing *ring){
+	return atomic_load(&ring->head) == atomic_load(&ring->tail);
+}
+
+static inline void chatRingPush(ChatRing *ring, ChatDoorbell *bell, const void *data, size_t size){
+	if (size > CHAT_RING_SLOT_BYTES) {
+		fprintf(stderr, "Frame of %zu bytes does not fit a ring slot\n", size);
+		exit(1);
+	}
+	uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	// never happens with one frame in flight per group, so a plain yield is enough
+	while (head - atomic_load(&ring->tail) == CHAT_RING_SLOTS)
+		sched_yield();
+
+	memcpy(ring->slots[head % CHAT_RING_SLOTS], data, size);
+	ring->sizes[head % CHAT_RING_SLOTS] = (uint32_t)size;
+	atomic_store(&ring->head, head + 1);
+	chatDoorbellRing(bell);
+}
+
+// Copies the oldest frame out and returns its size, or -1 if the ring is empty
+static inline int chatRingTryPop(ChatRing *ring, void *data, size_t capacity){
+	uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	if (atomic_load(&ring->head) == tail)
+		return -1;
+
+	size_t size = ring->sizes[tail % CHAT_RING_SLOTS];
+	memcpy(data, ring->slots[tail % CHAT_RING_SLOTS], size < capacity ? size : capacity);
+	atomic_store(&ring->tail, tail + 1);
+	return (int)size;
+}
+
+// Blocking pop for a consumer of a single ring
+static inline int chatRingPop(ChatRing *ring, ChatDoorbell *bell, void *data, size_t capacity){
+	for (int spins = 0; ; spins++) {
+		int size = chatRingTryPop(ring, data, capacity);
+		if (size >= 0)
+			return size;
+		if (spins < chatRingSpinLimit()) {
+			chatRingRelax();
+			continue;
+		}
+		uint32_t seen = chatDoorbellArm(bell);
+		chatDoorbellWait(bell, seen, !chatRingEmpty(ring));
+		spins = 0;
+	}
+}
+
+#endif
@@ -7,12 +7,33 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/msg.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include "chat_ring.h"
+#include "chat_config.h"
 
 
 #define MAX_GROUPS 30
 #define MAX_USERS 50
 #define MAX_TEXT_SIZE 256
 #define MAX_MESSAGE_TIMESTAMP 2147000000
+#define MAX_BATCH_SIZE 16   // user messages sent to the moderator per frame
+#define VERDICT_DISCARDED 2 // moderator's verdict for a message that would not have been sent one at a time
+#define PIPE_BUFFER_SIZE 8192 // bytes read ahead from each user pipe
+#define USER_WRITE_SIZE PIPE_BUF // bytes of whole records a user packs into one pipe write
+
+#ifdef CHAT_THREADS
+#define main groups_main        // app.c has the program's main and runs each group as a thread
+#define GROUP_STATE __thread    // one copy of the per-group globals below per group thread
+#else
+#define GROUP_STATE
+#endif
 
 #define READ_END 0
 #define WRITE_END 1
@@ -31,10 +52,11 @@ typedef struct{
     int modifyingGroup;
 } Message;
 
+//pipe record from a user: this header, then length bytes of text (no NUL)
 typedef struct{
     int timestamp;
-    char text[MAX_TEXT_SIZE];
     int userNum;
+    int length;
 } MsgToGroup;
 
 typedef struct{
@@ -42,57 +64,114 @@ typedef struct{
 	int group_Number;
 } Msg_GrpToApp;
 
+//followed by length + 1 bytes of text (NUL included)
 typedef struct{
-	long mtype;
-	int group_id;
 	int user_id;
 	int timestamp;
-	char mtext[256];
-	int Delete_user;
+	int userFinished;   // 1 if the user had no more messages after this one
+	int length;
+	char mtext[];
+} MsgEntry_GrpToMod;
+
+//bytes an entry takes in a frame, rounded up so the next entry's ints stay aligned
+#define MSG_ENTRY_SIZE(length) ((sizeof(MsgEntry_GrpToMod) + (length) + 1 + 3) & ~(size_t)3)
+#define MAX_FRAME_PAYLOAD (MAX_BATCH_SIZE * MSG_ENTRY_SIZE(MAX_TEXT_SIZE))
+
+//entries are packed back to back, each only as long as its text
+typedef struct{
+	long mtype;
+	int group_id;
 	int Group_status;
+	int activeUsers;    // active users before the first message of the frame
+	int count;
+	char entries[MAX_FRAME_PAYLOAD];
 }Msg_GrpToMod;
 
+typedef struct{
+	long mtype;
+	int count;
+	int Delete_user[MAX_BATCH_SIZE];
+}Msg_ModToGrp;
+
+
+// Loser tree over the users' head messages: leaf u holds the timestamp of user u's next message
+// (its text stays in userTexts[u]), each internal node the loser of the match played there and
+// node 0 the overall winner. Replacing the winner's key replays one match per level, moving no text.
+#define NO_HEAD INT64_MAX   // key of a leaf whose user has no message waiting
+
+typedef struct {
+    int64_t key;
+    int leaf;
+} TreeNode;
 
-// Min-heap structure
 typedef struct {
-    MsgToGroup *data;
-    int size;
-    int capacity;
-} MinHeap;
-
-// Min-heap functions
-MinHeap *createHeap(int capacity) {
-    MinHeap *heap = (MinHeap *)malloc(sizeof(MinHeap));
-    heap->data = (MsgToGroup *)malloc(capacity * sizeof(MsgToGroup));
-    heap->size = 0;
-    heap->capacity = capacity;
-    return heap;
+    int leaves;
+    int played;         // 0 while the first heads are filled in, before playLoserTree
+    TreeNode *nodes;    // nodes[0] is the winner, nodes[1..leaves-1] the losers; child c of a node is leaf c-leaves when c >= leaves
+    int64_t *keys;      // per leaf
+} LoserTree;
+
+static inline int beats(TreeNode a, TreeNode b) {   // earlier timestamp, then lower user number
+    return a.key < b.key || (a.key == b.key && a.leaf < b.leaf);
 }
 
-void insertHeap(MinHeap *heap, MsgToGroup msg) {
-    int i = heap->size++;
-    while (i > 0 && heap->data[(i - 1) / 2].timestamp > msg.timestamp) {
-        heap->data[i] = heap->data[(i - 1) / 2];
-        i = (i - 1) / 2;
+LoserTree *createLoserTree(int leaves) {
+    if (leaves < 1)
+        leaves = 1;
+    LoserTree *tree = (LoserTree *)malloc(sizeof(LoserTree));
+    tree->leaves = leaves;
+    tree->played = 0;
+    tree->nodes = (TreeNode *)malloc(leaves * sizeof(TreeNode));
+    tree->keys = (int64_t *)malloc(leaves * sizeof(int64_t));
+    if (tree->nodes == NULL || tree->keys == NULL) {
+        printf("Memory allocation failed for loser tree\n");  exit(1);
     }
-    heap->data[i] = msg;
+    for (int i = 0; i < leaves; i++)
+        tree->keys[i] = NO_HEAD;
+    return tree;
 }
 
-MsgToGroup removeMin(MinHeap *heap) {
-    MsgToGroup min = heap->data[0];
-    MsgToGroup last = heap->data[--heap->size];
-
-    int i = 0, child;
-    while ((child = 2 * i + 1) < heap->size) {
-        if (child + 1 < heap->size && heap->data[child + 1].timestamp < heap->data[child].timestamp)
-            child++;
-        if (last.timestamp <= heap->data[child].timestamp)
-            break;
-        heap->data[i] = heap->data[child];
-        i = child;
-    }
-    heap->data[i] = last;
-    return min;
+// Plays every match once, bottom up, from the keys set so far
+void playLoserTree(LoserTree *tree) {
+    int leaves = tree->leaves;
+    TreeNode *winners = (TreeNode *)malloc(2 * leaves * sizeof(TreeNode));
+    if (winners == NULL) {
+        printf("Memory allocation failed for loser tree\n");  exit(1);
+    }
+    for (int i = 0; i < leaves; i++) {
+        winners[leaves + i].key = tree->keys[i];
+        winners[leaves + i].leaf = i;
+    }
+    for (int node = leaves - 1; node > 0; node--) {
+        TreeNode a = winners[2 * node], b = winners[2 * node + 1];
+        winners[node] = beats(a, b) ? a : b;
+        tree->nodes[node] = beats(a, b) ? b : a;
+    }
+    tree->nodes[0] = winners[1];    // the leaf itself when there is only one
+    tree->played = 1;
+    free(winners);
+}
+
+// Sets a leaf's key (a timestamp or NO_HEAD). Once the tree is played only the winner's leaf may
+// change, and its matches on the way to the root are replayed.
+void updateLeaf(LoserTree *tree, int leaf, int64_t key) {
+    tree->keys[leaf] = key;
+    if (!tree->played)
+        return;
+    TreeNode winner = { key, leaf };
+    for (int node = (leaf + tree->leaves) / 2; node > 0; node /= 2) {
+        if (beats(tree->nodes[node], winner)) {
+            TreeNode loser = winner;
+            winner = tree->nodes[node];
+            tree->nodes[node] = loser;
+        }
+    }
+    tree->nodes[0] = winner;
+}
+
+// User whose message comes next, or -1 if no user has one waiting
+int treeWinner(LoserTree *tree) {
+    return tree->nodes[0].key == NO_HEAD ? -1 : tree->nodes[0].leaf;
 }
 
 
@@ -104,63 +183,287 @@ int extract_Y(const char *filepath) {
     return -1;  // Return -1 if format is incorrect
 }
 
-void clean_and_pad_text(char *str) {
+int clean_text(char *str) {    //Trims trailing whitespace, returns the length left
     int len = strlen(str);
-    // Trim trailing whitespace
     while (len > 0 && isspace((unsigned char)str[len - 1])) {
         str[--len] = '\0';
     }
-    // Ensure string is exactly MAX_TEXT_SIZE by padding with '\0'
-    while (len < MAX_TEXT_SIZE - 1) {
-        str[len++] = '\0';
+    return len;
+}
+
+//text of each user's message in the loser tree, NUL terminated
+GROUP_STATE char userTexts[MAX_USERS][MAX_TEXT_SIZE];
+GROUP_STATE int userTextLengths[MAX_USERS];
+
+//CHAT_USER_STREAMS=mmap: user files are mapped and parsed by the group itself, with no user processes or pipes
+typedef struct{
+    char *data;
+    size_t size;
+    size_t pos;
+} UserStream;
+
+GROUP_STATE UserStream userStreams[MAX_USERS];
+GROUP_STATE int useUserStreams = 0;
+
+int openUserStream(int u, const char *filepath) {  //returns -1 if the file cannot be opened
+    int fd = open(filepath, O_RDONLY);
+    if (fd == -1)
+        return -1;
+    struct stat st;
+    fstat(fd, &st);
+    userStreams[u].data = NULL;
+    userStreams[u].size = st.st_size;
+    userStreams[u].pos = 0;
+    if (st.st_size > 0) {
+        userStreams[u].data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (userStreams[u].data == MAP_FAILED) {
+            printf("mmap failed for %s\n", filepath);  exit(1);
+        }
+        madvise(userStreams[u].data, st.st_size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+    return 0;
+}
+
+void closeUserStream(int u) {
+    if (userStreams[u].data != NULL)
+        munmap(userStreams[u].data, userStreams[u].size);
+    userStreams[u].data = NULL;
+    userStreams[u].size = userStreams[u].pos = 0;
+}
+
+//Next "timestamp text" record of a user file, read the way the user process did it: fgets() in
+//chunks of at most MAX_TEXT_SIZE-1 bytes, keeping those sscanf("%d %s") accepts. Returns the text
+//length, or -1 at the end of the file.
+int nextUserRecord(UserStream *stream, int *timestamp, char *text) {
+    while (stream->pos < stream->size) {
+        const char *chunk = stream->data + stream->pos;
+        size_t limit = stream->size - stream->pos;
+        if (limit > MAX_TEXT_SIZE - 1)
+            limit = MAX_TEXT_SIZE - 1;
+        const char *newline = memchr(chunk, '\n', limit);
+        size_t chunkLength = newline ? (size_t)(newline - chunk) + 1 : limit;
+        stream->pos += chunkLength;
+
+        const char *nul = memchr(chunk, '\0', chunkLength);  //sscanf stops there
+        const char *p = chunk, *end = nul ? nul : chunk + chunkLength;
+
+        //%d
+        while (p < end && isspace((unsigned char)*p)) p++;
+        int negative = (p < end && (*p == '-' || *p == '+')) ? (*p++ == '-') : 0;
+        if (p == end || !isdigit((unsigned char)*p))
+            continue;
+        long value = 0;
+        while (p < end && isdigit((unsigned char)*p))
+            value = value * 10 + (*p++ - '0');
+        //" %s"
+        while (p < end && isspace((unsigned char)*p)) p++;
+        const char *word = p;
+        while (p < end && !isspace((unsigned char)*p)) p++;
+        if (p == word)
+            continue;
+
+        *timestamp = (int)(negative ? -value : value);
+        memcpy(text, word, p - word);
+        text[p - word] = '\0';
+        return p - word;
+    }
+    return -1;
+}
+
+void readFromStreamToTree(int u, LoserTree *heads, int *userStatuses, int *activeUsers) { //Parses next msg of a mapped user file into the tree. At the end, updates statuses
+    int timestamp;
+    int length = nextUserRecord(&userStreams[u], &timestamp, userTexts[u]);
+    if (length >= 0) {
+        userTextLengths[u] = length;
+        updateLeaf(heads, u, timestamp);
+    } else {
+        updateLeaf(heads, u, NO_HEAD);
+        closeUserStream(u);
+        userStatuses[u] = OVER;
+        (*activeUsers)--;
+    }
+}
+
+//User pipes are nonblocking and read ahead into a buffer each. A user whose next message is missing
+//is armed in epoll (one-shot), and the group sleeps until one of those pipes is readable.
+typedef struct{
+    char data[PIPE_BUFFER_SIZE];
+    int start;
+    int end;
+    int eof;
+} PipeBuffer;
+
+GROUP_STATE PipeBuffer *pipeBuffers;    //MAX_USERS of them, allocated only when users write to pipes
+GROUP_STATE int needsHead[MAX_USERS];   //active user without a message in the tree
+GROUP_STATE int armed[MAX_USERS];       //registered interest not yet reported by epoll
+GROUP_STATE int epollFd = -1;
+
+void writeRecords(int fd, const char *data, int size) {    //one write unless the group is slow to read
+    while (size > 0) {
+        int written = write(fd, data, size);
+        if (written == -1) {
+            if (errno == EINTR)
+                continue;
+            exit(1);    //group has gone
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+void watchUserPipe(int u, int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLONESHOT, .data.u32 = u };
+    if(epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) == -1){
+        printf("epoll_ctl failed\n");  exit(1);
+    }
+    armed[u] = 1;
+}
+
+void unwatchUserPipe(int u, int pipefds[][2]) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, pipefds[u][READ_END], NULL);
+    close(pipefds[u][READ_END]);
+    needsHead[u] = 0;
+}
+
+void fillPipeBuffer(int u, int pipefds[][2]) {  //reads whatever is there without blocking
+    PipeBuffer *b = &pipeBuffers[u];
+    if (b->start > 0) {
+        memmove(b->data, b->data + b->start, b->end - b->start);
+        b->end -= b->start;
+        b->start = 0;
     }
-    str[MAX_TEXT_SIZE - 1] = '\0';  // Ensure null termination
+    if (b->end == PIPE_BUFFER_SIZE || b->eof)
+        return;
+    int got = read(pipefds[u][READ_END], b->data + b->end, PIPE_BUFFER_SIZE - b->end);
+    if (got > 0)
+        b->end += got;
+    else if (got == 0 || (errno != EAGAIN && errno != EINTR))
+        b->eof = 1;
 }
 
-void readFromPipeToHeap(int X, int u, int pipefds[][2], MinHeap *heap, int *userStatuses, int *activeUsers) { //Reads msg from pipe and inserts into heap. If pipe is closed, updates statuses
+//Moves the user's next buffered message into the tree, or ends the user at its termination record
+//or end of pipe. Returns 0 if more bytes are needed first.
+int takeBufferedMessage(int u, int pipefds[][2], LoserTree *heads, int *userStatuses, int *activeUsers) {
+    PipeBuffer *b = &pipeBuffers[u];
     MsgToGroup msg;
-    if (read(pipefds[u][READ_END], &msg, sizeof(msg)) > 0) {
-        if(msg.timestamp != -1){
-            insertHeap(heap, msg);
-            //printf("***Group %d read %s from user %d and added to heap\n", X, msg.text, u);    
-        }else{
-            close(pipefds[u][READ_END]);
+    int available = b->end - b->start;
+    if (available >= (int)sizeof(msg)) {
+        memcpy(&msg, b->data + b->start, sizeof(msg));
+        if (msg.length < 0 || msg.length >= MAX_TEXT_SIZE)
+            b->eof = 1;     //not a record: stop reading this user
+        else if (available >= (int)sizeof(msg) + msg.length) {
+            b->start += sizeof(msg) + msg.length;
+            if(msg.timestamp != -1){
+                memcpy(userTexts[u], b->data + b->start - msg.length, msg.length);
+                userTexts[u][msg.length] = '\0';
+                userTextLengths[u] = msg.length;
+                updateLeaf(heads, u, msg.timestamp);
+                needsHead[u] = 0;
+                return 1;
+            }
+            // termination record from the user
+            updateLeaf(heads, u, NO_HEAD);
+            unwatchUserPipe(u, pipefds);
             userStatuses[u] = OVER;
             (*activeUsers)--;
-            //printf("***Group %d User %d pipe finished (termination signal received)\n", X, u);
+            return 1;
         }
+    }
+    if (!b->eof)
+        return 0;
+
+    // User process is done
+    updateLeaf(heads, u, NO_HEAD);
+    unwatchUserPipe(u, pipefds);
+    userStatuses[u] = OVER;
+    (*activeUsers)--;
+    return 1;
+}
 
-    } else {  // User process is done
-        close(pipefds[u][READ_END]);
-        userStatuses[u] = OVER;
-        (*activeUsers)--;
-        //printf("***Group %d User %d nothing more in pipe\n", X, u);
+//Blocks until every user marked in needsHead has a message in the tree or has finished, so the
+//tree's winner is the true next message
+void refillHeads(int pipefds[][2], LoserTree *heads, int *userStatuses, int *activeUsers) {
+    int waiting = 0;
+    for (int u = 0; u < MAX_USERS; u++) {
+        if (!needsHead[u])
+            continue;
+        if (!takeBufferedMessage(u, pipefds, heads, userStatuses, activeUsers)) {
+            fillPipeBuffer(u, pipefds);
+            if (takeBufferedMessage(u, pipefds, heads, userStatuses, activeUsers))
+                continue;
+            if (!armed[u]) {
+                struct epoll_event ev = { .events = EPOLLIN | EPOLLONESHOT, .data.u32 = u };
+                epoll_ctl(epollFd, EPOLL_CTL_MOD, pipefds[u][READ_END], &ev);
+                armed[u] = 1;
+            }
+            waiting++;
+        }
+    }
+
+    struct epoll_event events[MAX_USERS];
+    while (waiting > 0) {
+        int ready = epoll_wait(epollFd, events, MAX_USERS, -1);
+        if (ready == -1) {
+            if (errno == EINTR)
+                continue;
+            printf("epoll_wait failed\n");  exit(1);
+        }
+        for (int i = 0; i < ready; i++) {
+            int u = events[i].data.u32;
+            armed[u] = 0;
+            if (userStatuses[u] != ACTIVE)
+                continue;
+            fillPipeBuffer(u, pipefds);
+            if (!needsHead[u])
+                continue;   //read ahead for later
+            if (takeBufferedMessage(u, pipefds, heads, userStatuses, activeUsers)) {
+                waiting--;
+            } else {
+                struct epoll_event ev = { .events = EPOLLIN | EPOLLONESHOT, .data.u32 = u };
+                epoll_ctl(epollFd, EPOLL_CTL_MOD, pipefds[u][READ_END], &ev);
+                armed[u] = 1;
+            }
+        }
     }
 }
 
 
+//Set by app.c's threaded runtime: frames are checked by moderator.c in this process, on this thread
+void (*inProcessModerator)(const void *frame, size_t size, void *verdicts) = NULL;
+
 int main(int argc, char *argv[]){
 
-    //Receive X(group number) and Testcase number from app.c
-    if(argc != 3){
+    //Receive X(group number), Testcase number and the parsed input.txt's fd from app.c
+    if(argc != 3 && argc != 4){
         printf("Incorrect no. of args"); exit(1);
     }
     int testcaseNum = atoi(argv[1]);
     int X = atoi(argv[2]);
 
-    //Get message queue IDs from input.txt
+    //Get message queue IDs from app.c's parsed copy of input.txt, or from the file when run on its own
     int key_validation, key_app, key_moderator;
-    char input_filepath[100];
-    snprintf(input_filepath, sizeof(input_filepath), "testcase_%d/input.txt", testcaseNum);
-    FILE* input_file = fopen(input_filepath, "r");
-    if(!input_file){
-        printf("Error opening input.txt");  exit(1);
-    }
-    int skip;
-    fscanf(input_file, "%d", &skip);  // Read and ignore the first line
-    fscanf(input_file, "%d", &key_validation);  
-    fscanf(input_file, "%d", &key_app);  
-    fscanf(input_file, "%d", &key_moderator);  
+    if(argc == 4){
+        const ChatConfig *config = attachChatConfig(atoi(argv[3]));
+        key_validation = config->keyValidation;
+        key_app = config->keyApp;
+        key_moderator = config->keyModerator;
+        munmap((void *)config, sizeof(ChatConfig));
+    } else{
+        char input_filepath[100];
+        snprintf(input_filepath, sizeof(input_filepath), "testcase_%d/input.txt", testcaseNum);
+        FILE* input_file = fopen(input_filepath, "r");
+        if(!input_file){
+            printf("Error opening input.txt");  exit(1);
+        }
+        int skip;
+        fscanf(input_file, "%d", &skip);  // Read and ignore the first line
+        fscanf(input_file, "%d", &key_validation);  
+        fscanf(input_file, "%d", &key_app);  
+        fscanf(input_file, "%d", &key_moderator);  
+        fclose(input_file);
+    }
 
         //printf("***groups read keys %d %d %d\n", key_validation, key_app, key_moderator);  // ***
 
@@ -169,8 +472,8 @@ int main(int argc, char *argv[]){
     if(msgID_validation == -1){
         printf("msgget failed\n");  exit(1);
     }
-    msgID_moderator = msgget(key_moderator, 0666|IPC_CREAT);
-    if(msgID_moderator == -1){
+    msgID_moderator = inProcessModerator ? -1 : msgget(key_moderator, 0666|IPC_CREAT);
+    if(msgID_moderator == -1 && !inProcessModerator){
         printf("msgget failed\n");  exit(1);
     }
     msgID_app= msgget(key_app, 0666|IPC_CREAT);
@@ -180,6 +483,18 @@ int main(int argc, char *argv[]){
 
         //printf("***groups message IDs created\n");  // ***
 
+    //CHAT_TRANSPORT=shm: talk to moderator.c over this group's shared memory rings instead of the queue
+    ChatRings *chatRings = NULL;
+    if(inProcessModerator && (X < 0 || X >= MAX_GROUPS)){
+        printf("Group %d is outside the %d in-process moderation slots\n", X, MAX_GROUPS);  exit(1);
+    }
+    if(!inProcessModerator && chatRingsSelected()){
+        if(X < 0 || X >= CHAT_RING_GROUPS){
+            printf("Group %d is outside the %d shared memory rings\n", X, CHAT_RING_GROUPS);  exit(1);
+        }
+        chatRings = attachChatRings(key_moderator);
+    }
+
     //Send Message to validation.out
     Message grpCreated;
     grpCreated.mtype = 1;
@@ -217,17 +532,52 @@ int main(int argc, char *argv[]){
     //declare child pids
     pid_t childPIDs[MAX_USERS];
 
-    //Fork each user process
+    //Fork each user process (or map its file, with CHAT_USER_STREAMS=mmap)
+    const char *userStreamMode = getenv("CHAT_USER_STREAMS");
+    useUserStreams = inProcessModerator != NULL || (userStreamMode != NULL && strcmp(userStreamMode, "mmap") == 0);  //a group thread cannot fork users
     char user_filepath[100];
     pid_t pid;
+    int userSlots = 0;  //highest user no. + 1, the loser tree's width
+    if(!useUserStreams){
+        if((epollFd = epoll_create1(0)) == -1){
+            printf("epoll_create1 failed\n");  exit(1);
+        }
+        pipeBuffers = (PipeBuffer *)calloc(MAX_USERS, sizeof(PipeBuffer));
+        if(pipeBuffers == NULL){
+            printf("Memory allocation failed for pipe buffers\n");  exit(1);
+        }
+    }
     for(int i=0; i<M; i++){
         fscanf(group_file, "%s", user_filepath);
         char user_filepath_extended[300];
         snprintf(user_filepath_extended, sizeof(user_filepath_extended), "testcase_%d/%s", testcaseNum, user_filepath);
         int Y = extract_Y(user_filepath);   //get user no.
+        if(Y + 1 > userSlots)
+            userSlots = Y + 1;
 
             //printf("*** extracted Y=%d\n", Y);      //***
 
+        if(useUserStreams){
+            userStatuses[Y] = ACTIVE;
+            if(openUserStream(Y, user_filepath_extended) == -1){
+                //like a user process that could not open its file: no validation message, no messages
+                printf("Error opening %s\n", user_filepath_extended);
+                userStreams[Y].data = NULL;
+                userStreams[Y].size = userStreams[Y].pos = 0;
+                continue;
+            }
+
+            //Inform validation.out
+            Message userCreated;
+            userCreated.mtype = 2;
+            userCreated.user = Y;
+            userCreated.modifyingGroup = X;
+            if(msgsnd(msgID_validation, (void*)&userCreated, sizeof(Message)-sizeof(long), 0) == -1){
+                printf("Error in sending userCreated to validation - Group %d\n", X);   exit(1);
+            }
+            continue;
+        }
+
         //Create a pipe
         if(pipe(pipefds[Y]) == -1){
             printf("Pipe creation failed\n");   exit(1);
@@ -265,27 +615,40 @@ int main(int argc, char *argv[]){
 
                 //printf("***Group %d user %d created - informed validation\n", X, Y);  // ***
 
-            //Read timestamps and texts, send to Parent
+            //Read timestamps and texts, send to Parent in writes of whole records
             int timestamp;
             char line[MAX_TEXT_SIZE], text[MAX_TEXT_SIZE];
+            char records[USER_WRITE_SIZE];
+            int batched = 0;
             MsgToGroup msgtoGrp;
 
             while(fgets(line, sizeof(line), user_file)){    //while lines are there in user_X_Y.txt
                 if(sscanf(line, "%d %s", &timestamp, text) == 2){    //extract timestamp and text, put in pipe
-                    clean_and_pad_text(text);
-
                     msgtoGrp.timestamp = timestamp;
-                    strcpy(msgtoGrp.text, text);
                     msgtoGrp.userNum = Y;
+                    msgtoGrp.length = clean_text(text);
 
-                    write(pipefds[Y][WRITE_END], &msgtoGrp, sizeof(MsgToGroup));
+                    if(batched + sizeof(MsgToGroup) + msgtoGrp.length > sizeof(records)){
+                        writeRecords(pipefds[Y][WRITE_END], records, batched);
+                        batched = 0;
+                    }
+                    memcpy(records + batched, &msgtoGrp, sizeof(MsgToGroup));
+                    memcpy(records + batched + sizeof(MsgToGroup), text, msgtoGrp.length);
+                    batched += sizeof(MsgToGroup) + msgtoGrp.length;
 
                     //printf("***User %d Group %d written to pipe\n", Y, X);        //***
                 }
             }
             //after lines are over
             msgtoGrp.timestamp = -1;
-            write(pipefds[Y][WRITE_END], &msgtoGrp, sizeof(MsgToGroup));
+            msgtoGrp.length = 0;
+            if(batched + sizeof(MsgToGroup) > sizeof(records)){
+                writeRecords(pipefds[Y][WRITE_END], records, batched);
+                batched = 0;
+            }
+            memcpy(records + batched, &msgtoGrp, sizeof(MsgToGroup));
+            batched += sizeof(MsgToGroup);
+            writeRecords(pipefds[Y][WRITE_END], records, batched);
             close(pipefds[Y][WRITE_END]);
 
             //printf("***User %d (Group %d) finished reading file\n", Y, X);          /// ***
@@ -295,6 +658,7 @@ int main(int argc, char *argv[]){
         //Parent Process - for each user
         userStatuses[Y] = ACTIVE;
         close(pipefds[Y][WRITE_END]);
+        watchUserPipe(Y, pipefds[Y][READ_END]);
         childPIDs[Y] = pid;
     }
     
@@ -304,86 +668,121 @@ int main(int argc, char *argv[]){
     MsgToGroup msg;
     int activeUsers = M;
     int violatingUsers = 0;
-    MinHeap *heap = createHeap(MAX_USERS);
+    LoserTree *heads = createLoserTree(userSlots);
 
     //first, take in one message each from all users
-    for(int u=0; u<MAX_USERS; u++){     //take in message from each user
+    for(int u=0; u<userSlots; u++){     //take in message from each user
         if(userStatuses[u] == ACTIVE){
-            readFromPipeToHeap(X, u, pipefds, heap, userStatuses, &activeUsers);
+            if(useUserStreams)
+                readFromStreamToTree(u, heads, userStatuses, &activeUsers);
+            else
+                needsHead[u] = 1;
         }
     }
+    if(!useUserStreams)
+        refillHeads(pipefds, heads, userStatuses, &activeUsers);
+    playLoserTree(heads);
 
-    //send out oldest msg, look for next msg from the same user. If not available, go to next user - repeat while 2 or more users are active
+    //send out oldest msgs in frames of up to MAX_BATCH_SIZE - repeat while 2 or more users are active.
+    //Each message is assumed ok while the frame is built, so the next msg from the same user is read
+    //straight away; the moderator replays the one-at-a-time rules and the verdicts settle the real state.
     
     while(activeUsers >= 2){
-        if(heap->size > 0){
-            //get lowest timestamp msg
-            MsgToGroup msg_out = removeMin(heap);
-
-            if(userStatuses[msg_out.userNum] == ACTIVE){
-                //printf("\t***Heap sent out %s from user %d (Group %d) at %d\n", msg_out.text, msg_out.userNum, X, msg_out.timestamp);
-                //send msg to moderator.c
-                Msg_GrpToMod msgToMod;
-                msgToMod.mtype = 1;
-                msgToMod.group_id = X;
-                msgToMod.user_id = msg_out.userNum;
-                msgToMod.timestamp = msg_out.timestamp;
-                strcpy(msgToMod.mtext, msg_out.text);
-                msgToMod.Group_status = 0;  //Group_status = 0 for messages
-                if(msgsnd(msgID_moderator, &msgToMod, sizeof(Msg_GrpToMod)-sizeof(long), 0) == -1){
-                    printf("Error in sending message to moderator - Group %d\n", X);  exit(1);
-                }
+        Msg_GrpToMod msgToMod;
+        msgToMod.mtype = 1;
+        msgToMod.group_id = X;
+        msgToMod.Group_status = 0;  //Group_status = 0 for messages
+        msgToMod.activeUsers = activeUsers;
+        msgToMod.count = 0;
+
+        int activeBefore = activeUsers;
+        size_t payload = 0;
+        int u;
+        while(msgToMod.count < MAX_BATCH_SIZE && activeUsers >= 2 && (u = treeWinner(heads)) >= 0){
+            //lowest timestamp msg; the user's next msg takes its place in the tree below
+            if(userStatuses[u] != ACTIVE){  //killed with a msg still in the tree
+                updateLeaf(heads, u, NO_HEAD);
+                continue;
+            }
+            MsgEntry_GrpToMod *entry = (MsgEntry_GrpToMod *)(msgToMod.entries + payload);
+            entry->user_id = u;
+            entry->timestamp = (int)heads->keys[u];
+            entry->length = userTextLengths[u];
+            memcpy(entry->mtext, userTexts[u], entry->length + 1);
+            payload += MSG_ENTRY_SIZE(entry->length);
+            msgToMod.count++;
+
+            //get next msg from same user
+            if(useUserStreams)
+                readFromStreamToTree(u, heads, userStatuses, &activeUsers);
+            else{
+                needsHead[u] = 1;
+                refillHeads(pipefds, heads, userStatuses, &activeUsers);
+            }
+            entry->userFinished = (userStatuses[u] == OVER);
+        }
+        if(msgToMod.count == 0)
+            continue;
+
+        //send msgs to moderator.c, then receive ok/not ok for each msg
+        size_t frameSize = offsetof(Msg_GrpToMod, entries) + payload - sizeof(long);
+        Msg_ModToGrp msg_fromMod;
+        if(inProcessModerator){
+            inProcessModerator(&msgToMod, frameSize + sizeof(long), &msg_fromMod);
+        } else if(chatRings){
+            chatRingPush(&chatRings->groups[X].toModerator, &chatRings->moderatorBell, &msgToMod, frameSize + sizeof(long));
+            chatRingPop(&chatRings->groups[X].toGroup, &chatRings->groups[X].groupBell, &msg_fromMod, sizeof(msg_fromMod));
+        } else{
+            if(msgsnd(msgID_moderator, &msgToMod, frameSize, 0) == -1){
+                printf("Error in sending message to moderator - Group %d\n", X);  exit(1);
+            }
+            if(msgrcv(msgID_moderator, &msg_fromMod, sizeof(msg_fromMod)-sizeof(long), (MAX_GROUPS + X), 0) == -1){
+                printf("Error in receiving from moderator");    exit(1);
+            }
+        }
 
-                //printf("***Group %d User %d: sent msg to moderator - %s\n", X, msg_out.userNum, msg_out.text);                  /// ***
+        activeUsers = activeBefore;
+        char *next = msgToMod.entries;
+        for(int i=0; i<msgToMod.count; i++){
+            MsgEntry_GrpToMod *entry = (MsgEntry_GrpToMod *)next;
+            next += MSG_ENTRY_SIZE(entry->length);
+            if(msg_fromMod.Delete_user[i] == VERDICT_DISCARDED)
+                continue;
+
+            //ok or not, the text goes to validation.out
+            Message msgToVal;
+            msgToVal.mtype = (MAX_GROUPS + X);
+            msgToVal.timestamp = entry->timestamp;
+            msgToVal.user = entry->user_id;
+            memcpy(msgToVal.mtext, entry->mtext, entry->length + 1);
+            if(msgsnd(msgID_validation, (void*)&msgToVal, sizeof(Message)-sizeof(long), 0) == -1){
+                printf("Error in sending message to validation - Group %d\n", X);  exit(1);
+            }
 
-                //receive ok/not ok from moderator.c
-                Msg_GrpToMod msg_fromMod;
-                if(msgrcv(msgID_moderator, &msg_fromMod, sizeof(msg_fromMod)-sizeof(long), (MAX_GROUPS + X), 0) == -1){
-                    printf("Error in receiving from moderator");    exit(1);
+            if(msg_fromMod.Delete_user[i]){ //not ok: kill user process (or drop its file) and update statuses
+                if(useUserStreams)
+                    closeUserStream(entry->user_id);
+                else{
+                    kill(childPIDs[entry->user_id], SIGTERM);
+                    if(userStatuses[entry->user_id] == ACTIVE)
+                        unwatchUserPipe(entry->user_id, pipefds);
                 }
-                int userOK = !msg_fromMod.Delete_user;
-                //printf("***Group %d User %d: received %s from moderator\n", X, msg_out.userNum, userOK?"ok":"NOT ok");      /// ***           
-
-                if(userOK){ //if ok, send text to validation.out, else, kill user process and update statuses
-                    Message msgToVal;
-                    msgToVal.mtype = (MAX_GROUPS + X);
-                    msgToVal.timestamp = msg_out.timestamp;
-                    msgToVal.user = msg_out.userNum;
-                    strcpy(msgToVal.mtext, msg_out.text);
-                    if(msgsnd(msgID_validation, (void*)&msgToVal, sizeof(Message)-sizeof(long), 0) == -1){
-                        printf("Error in sending message to validation - Group %d\n", X);  exit(1);
-                    }
-                   // printf("***Group %d User %d: sent msg to validation - %s\n", X, msg_out.userNum, msgToVal.mtext);             /// ***
-
-                    //get next msg from same user
-                    readFromPipeToHeap(X, msg_out.userNum, pipefds, heap, userStatuses, &activeUsers);
-                    //printf("***Group %d User %d: next msg from user; (User Status %d)\n", X, msg_out.userNum, userStatuses[msg_out.userNum]);                               /// ***
-                } else{
-                    Message msgToVal;
-                    msgToVal.mtype = (MAX_GROUPS + X);
-                    msgToVal.timestamp = msg_out.timestamp;
-                    msgToVal.user = msg_out.userNum;
-                    strcpy(msgToVal.mtext, msg_out.text);
-                    if(msgsnd(msgID_validation, (void*)&msgToVal, sizeof(Message)-sizeof(long), 0) == -1){
-                        printf("Error in sending message to validation - Group %d\n", X);  exit(1);
-                    }
-                    //printf("***Group %d User %d: sent msg to validation - %s\n", X, msg_out.userNum, msgToVal.mtext); 
-                    
-                    kill(childPIDs[msg_out.userNum], SIGTERM);
-                    userStatuses[msg_out.userNum] = KILLED;
-                    violatingUsers++;
-                    activeUsers--;
-                    //readFromPipeToHeap(X, msg_out.userNum, pipefds, heap, userStatuses, &activeUsers);
-                    //printf("***Group %d user %d Killed\n", X, msg_out.userNum);                                  /// ***
-                } 
+                userStatuses[entry->user_id] = KILLED;
+                violatingUsers++;
+                activeUsers--;
+            } else if(entry->userFinished){
+                activeUsers--;
             }
-
         }
 
     }
 
     //Group termination
     for (int i = 0; i < MAX_USERS; i++) {
+        if(useUserStreams){
+            closeUserStream(i);
+            continue;
+        }
 		close(pipefds[i][READ_END]);
 		close(pipefds[i][WRITE_END]);
 	}
@@ -393,8 +792,14 @@ int main(int argc, char *argv[]){
     //send info to moderator.c
     Msg_GrpToMod grpTerminated_toMod;
     grpTerminated_toMod.mtype = 1;
+    grpTerminated_toMod.group_id = X;
     grpTerminated_toMod.Group_status = 1;
-    if(msgsnd(msgID_moderator, (void*)&grpTerminated_toMod, sizeof(Msg_GrpToMod)-sizeof(long), 0) == -1){
+    grpTerminated_toMod.count = 0;
+    if(inProcessModerator){
+        //nothing to tell: there is no moderator loop counting the groups still running
+    } else if(chatRings){
+        chatRingPush(&chatRings->groups[X].toModerator, &chatRings->moderatorBell, &grpTerminated_toMod, offsetof(Msg_GrpToMod, entries));
+    } else if(msgsnd(msgID_moderator, (void*)&grpTerminated_toMod, offsetof(Msg_GrpToMod, entries)-sizeof(long), 0) == -1){
         printf("Error in sending grpTerminated_toMod - Group %d\n", X);  exit(1);
     }
     //printf("***Group %d termination sent to moderator\n", X);                                               /// ***
@@ -418,6 +823,10 @@ int main(int argc, char *argv[]){
     }
     //printf("***Group %d termination sent to app\n", X);                                                     /// ***
 
-    exit(0);
+    free(pipeBuffers);
+    free(heads->nodes);
+    free(heads->keys);
+    free(heads);
+    return 0;
 }
 
@@ -0,0 +1,218 @@
+// Benchmarks the group's merge of per-user message streams: the original min-heap of whole
+// messages, the min-heap of (timestamp, user) entries it became, and the loser tree groups.c uses.
+// Build: gcc -O2 -o groups_bench groups_bench.c
+// Run:   ./groups_bench [messages]
+#define main groups_main
+#include "groups.c"
+#undef main
+
+#include <time.h>
+
+// The original heap record: the text travelled through the heap with its timestamp
+typedef struct {
+    int timestamp;
+    char text[MAX_TEXT_SIZE];
+    int userNum;
+} WholeMessage;
+
+typedef struct {
+    WholeMessage *data;
+    int size;
+} WholeMessageHeap;
+
+void insertWholeMessage(WholeMessageHeap *heap, WholeMessage msg) {
+    int i = heap->size++;
+    while (i > 0 && heap->data[(i - 1) / 2].timestamp > msg.timestamp) {
+        heap->data[i] = heap->data[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->data[i] = msg;
+}
+
+WholeMessage removeMinWholeMessage(WholeMessageHeap *heap) {
+    WholeMessage min = heap->data[0];
+    WholeMessage last = heap->data[--heap->size];
+
+    int i = 0, child;
+    while ((child = 2 * i + 1) < heap->size) {
+        if (child + 1 < heap->size && heap->data[child + 1].timestamp < heap->data[child].timestamp)
+            child++;
+        if (last.timestamp <= heap->data[child].timestamp)
+            break;
+        heap->data[i] = heap->data[child];
+        i = child;
+    }
+    heap->data[i] = last;
+    return min;
+}
+
+// The (timestamp, user) heap groups.c used before the loser tree
+typedef struct {
+    int timestamp;
+    int userNum;
+} HeadEntry;
+
+typedef struct {
+    HeadEntry *data;
+    int size;
+} HeadHeap;
+
+void insertHead(HeadHeap *heap, HeadEntry entry) {
+    int i = heap->size++;
+    while (i > 0 && heap->data[(i - 1) / 2].timestamp > entry.timestamp) {
+        heap->data[i] = heap->data[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->data[i] = entry;
+}
+
+HeadEntry removeMinHead(HeadHeap *heap) {
+    HeadEntry min = heap->data[0];
+    HeadEntry last = heap->data[--heap->size];
+
+    int i = 0, child;
+    while ((child = 2 * i + 1) < heap->size) {
+        if (child + 1 < heap->size && heap->data[child + 1].timestamp < heap->data[child].timestamp)
+            child++;
+        if (last.timestamp <= heap->data[child].timestamp)
+            break;
+        heap->data[i] = heap->data[child];
+        i = child;
+    }
+    heap->data[i] = last;
+    return min;
+}
+
+unsigned int benchSeed = 12345;
+
+int benchRandom(int n) {
+    benchSeed = benchSeed * 1103515245 + 12345;
+    return (benchSeed >> 8) % n;
+}
+
+double secondsSince(struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Each user's stream: increasing timestamps and short texts, read in place like a mapped user file
+int users, perUser;
+int *timestamps;        // users * perUser
+char (*texts)[16];      // users * perUser
+int *positions;         // next message of each user
+
+void makeStreams(int userCount, int messages) {
+    users = userCount;
+    perUser = messages / users;
+    timestamps = (int *)malloc((size_t)users * perUser * sizeof(int));
+    texts = malloc((size_t)users * perUser * sizeof(*texts));
+    positions = (int *)malloc(users * sizeof(int));
+    for (int u = 0; u < users; u++) {
+        int step = 0;
+        for (int i = 0; i < perUser; i++) {
+            step += 1 + benchRandom(3);
+            timestamps[u * perUser + i] = step * users + u;    // distinct, so every merge has one order
+            int length = 3 + benchRandom(12);
+            for (int c = 0; c < length; c++)
+                texts[u * perUser + i][c] = 'a' + benchRandom(26);
+            texts[u * perUser + i][length] = '\0';
+        }
+    }
+}
+
+void freeStreams(void) {
+    free(timestamps);
+    free(texts);
+    free(positions);
+}
+
+// Every merge sums what a group would send, so the three must agree
+long long mergeWholeMessages(void) {
+    WholeMessageHeap heap = { (WholeMessage *)malloc(users * sizeof(WholeMessage)), 0 };
+    long long checksum = 0;
+    for (int u = 0; u < users; u++) {
+        WholeMessage msg = { timestamps[u * perUser], "", u };
+        strcpy(msg.text, texts[u * perUser]);
+        insertWholeMessage(&heap, msg);
+        positions[u] = 1;
+    }
+    while (heap.size > 0) {
+        WholeMessage msg = removeMinWholeMessage(&heap);
+        checksum = checksum * 31 + msg.timestamp + msg.userNum + msg.text[0];
+        int u = msg.userNum;
+        if (positions[u] < perUser) {
+            WholeMessage next = { timestamps[u * perUser + positions[u]], "", u };
+            strcpy(next.text, texts[u * perUser + positions[u]]);
+            insertWholeMessage(&heap, next);
+            positions[u]++;
+        }
+    }
+    free(heap.data);
+    return checksum;
+}
+
+long long mergeHeads(void) {
+    HeadHeap heap = { (HeadEntry *)malloc(users * sizeof(HeadEntry)), 0 };
+    long long checksum = 0;
+    for (int u = 0; u < users; u++) {
+        HeadEntry entry = { timestamps[u * perUser], u };
+        insertHead(&heap, entry);
+        positions[u] = 0;
+    }
+    while (heap.size > 0) {
+        HeadEntry entry = removeMinHead(&heap);
+        int u = entry.userNum;
+        checksum = checksum * 31 + entry.timestamp + u + texts[u * perUser + positions[u]][0];
+        if (++positions[u] < perUser) {
+            HeadEntry next = { timestamps[u * perUser + positions[u]], u };
+            insertHead(&heap, next);
+        }
+    }
+    free(heap.data);
+    return checksum;
+}
+
+long long mergeLoserTree(void) {
+    LoserTree *tree = createLoserTree(users);
+    long long checksum = 0;
+    for (int u = 0; u < users; u++) {
+        updateLeaf(tree, u, timestamps[u * perUser]);
+        positions[u] = 0;
+    }
+    playLoserTree(tree);
+    int u;
+    while ((u = treeWinner(tree)) >= 0) {
+        checksum = checksum * 31 + tree->keys[u] + u + texts[u * perUser + positions[u]][0];
+        if (++positions[u] < perUser)
+            updateLeaf(tree, u, timestamps[u * perUser + positions[u]]);
+        else
+            updateLeaf(tree, u, NO_HEAD);
+    }
+    free(tree->nodes);
+    free(tree->keys);
+    free(tree);
+    return checksum;
+}
+
+int main(int argc, char *argv[]) {
+    int messages = argc > 1 ? atoi(argv[1]) : 2000000;
+    int userCounts[] = {50, 1000, 10000};
+    const char *names[] = {"whole-message heap", "(timestamp, user) heap", "loser tree"};
+    long long (*merges[])(void) = {mergeWholeMessages, mergeHeads, mergeLoserTree};
+
+    for (int c = 0; c < 3; c++) {
+        makeStreams(userCounts[c], messages);
+        long long total = (long long)users * perUser;
+        for (int m = 0; m < 3; m++) {
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            long long checksum = merges[m]();
+            double seconds = secondsSince(&start);
+            printf("%5d users, %-22s: %6.1f ns/message, %6.2f M messages/s, checksum %lld\n",
+                   users, names[m], seconds * 1e9 / total, total / seconds / 1e6, checksum);
+        }
+        freeStreams();
+    }
+    return 0;
+}
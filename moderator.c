@@ -6,6 +6,15 @@
 #include <sys/ipc.h>    
 #include <sys/msg.h>  
 #include <unistd.h>  
+#include <stdint.h>
+#include <pthread.h>
+#include <stddef.h>
+#include "chat_ring.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
 
 
 #define MAX_FILTERED_WORDS 50
@@ -13,25 +22,66 @@
 #define MAX_TIMESTAMP 2147000000
 #define MAX_TEXT_SIZE 256
 #define MAX_GRP_SIZE 30
+#define MAX_ANCHOR_BYTES 16 // beyond this the prefilter switches from anchor bytes to a bigram bitmap
+#define CACHE_LINE_SIZE 64
+#define MIN_VIOLATION_SLOTS 64
+#define VIOLATION_CACHE_SETS 1024 // per worker; each set is one cache line of VIOLATION_CACHE_WAYS entries
+#define VIOLATION_CACHE_WAYS 4
+#define VIOLATION_CACHE_MIN_LENGTH 32 // shorter texts scan faster than they hash and probe
+#define MAX_BATCH_SIZE 16 // user messages per frame from a group
+#define VERDICT_DISCARDED 2 // message would never have been sent one at a time (user removed, or group over)
+
+// Total violations per (group, user), in an open-addressing table. Only users with at least one
+// violation take a slot, so memory follows the users who actually misbehave, not the largest id.
+// There is one table per worker and a group always lives in its worker's table, so no locking.
+typedef struct{
+	uint64_t *keys; // ((group << 32) | user) + 1, 0 marks an empty slot
+	int *counts;
+	size_t capacity; // power of two
+	size_t used;
+}__attribute__((aligned(CACHE_LINE_SIZE))) ViolationTable;
 
-int TrackViolations[30][50]={{0}}; // Tracks total violations of all users in all groups
+ViolationTable defaultViolationTable;
+ViolationTable *violationTables=&defaultViolationTable; // indexed by group_id % numWorkers
+int numWorkers=1;
 int Threshold; // stores threshold value given in input.txt file of a testcase
 int filteredWordCount; //stores number of filtered words in filtered_words.txt for testcase 
 char** filteredWords=NULL; //To store the filtered words
 int NumberOfGroups; // Number of groups in a test case
 
-//struct used to communicate with groups.c using message queue
+// one user message inside a frame from groups.c, followed by length + 1 bytes of text (NUL included)
 typedef struct{
-	long mtype;
-	int group_id;
 	int user_id;
 	int timestamp;
-	char mtext[256];
-	int Delete_user;
+	int userFinished; // 1 if this was the user's last message
+	int length;
+	char mtext[];
+}msgEntry;
+
+// bytes an entry takes in a frame, rounded up so the next entry's ints stay aligned
+#define MSG_ENTRY_SIZE(length) ((sizeof(msgEntry) + (length) + 1 + 3) & ~(size_t)3)
+#define MAX_FRAME_PAYLOAD (MAX_BATCH_SIZE * MSG_ENTRY_SIZE(MAX_TEXT_SIZE))
+
+//struct used to communicate with groups.c using message queue: up to MAX_BATCH_SIZE messages in heap order,
+//packed back to back and only as long as their texts
+typedef struct{
+	long mtype;
+	int group_id;
 	int Group_status;
+	int activeUsers; // active users in the group before the first message of the frame
+	int count;
+	char entries[MAX_FRAME_PAYLOAD];
 }msg;
 
+// verdicts sent back to groups.c, one per message of the frame
+typedef struct{
+	long mtype;
+	int count;
+	int Delete_user[MAX_BATCH_SIZE]; // 0 keep, 1 delete user, VERDICT_DISCARDED
+}verdictMsg;
+
 msg message; // global variable to store the message of type msg received from groups.c 
+ChatRings *chatRings=NULL; // set when groups talk to the moderator over shared memory rings
 
 //Function to convert string to lowercase
 void toLowerCase(char *str) {
@@ -83,79 +133,667 @@ int getInputParameters(FILE * file){
 	return key;
 }
 
+// Aho-Corasick automaton over the filtered words, built once in getFilteredWords, so a
+// message is scanned once however many words there are. Bytes are mapped to a compact
+// alphabet of the characters that occur in filtered words (class 0 is every other byte,
+// which always leads back to the root), and the goto/failure links are folded into a
+// full transition table.
+int acAlphabetSize; // number of byte classes, including class 0
+unsigned char acByteClass[256];
+int *acNext; // acNext[state * acAlphabetSize + class]
+int *acMatchCount; // filtered words ending at a state, counting those that are suffixes of others
+int acStateCount;
+int filterVersion; // bumped whenever the dictionary is rebuilt, so cached counts can be dropped
+
+void buildFilterAutomaton(){
+    // Byte classes
+    memset(acByteClass, 0, sizeof(acByteClass));
+    acAlphabetSize = 1;
+    int trieSize = 1;
+    for (int i = 0; i < filteredWordCount; i++) {
+        for (const unsigned char *c = (const unsigned char *)filteredWords[i]; *c; c++) {
+            if (acByteClass[*c] == 0) {
+                acByteClass[*c] = acAlphabetSize++;
+            }
+            trieSize++;
+        }
+    }
+
+    acNext = (int *)calloc((size_t)trieSize * acAlphabetSize, sizeof(int));
+    acMatchCount = (int *)calloc(trieSize, sizeof(int));
+    int *fail = (int *)calloc(trieSize, sizeof(int));
+    int *queue = (int *)malloc(trieSize * sizeof(int));
+    if (acNext == NULL || acMatchCount == NULL || fail == NULL || queue == NULL) {
+        perror("Memory allocation failed for filter automaton");
+        exit(1);
+    }
+
+    // Trie; 0 doubles as "no child" since nothing points back at the root yet
+    acStateCount = 1;
+    for (int i = 0; i < filteredWordCount; i++) {
+        int state = 0;
+        for (const unsigned char *c = (const unsigned char *)filteredWords[i]; *c; c++) {
+            int *next = &acNext[state * acAlphabetSize + acByteClass[*c]];
+            if (*next == 0) {
+                *next = acStateCount++;
+            }
+            state = *next;
+        }
+        acMatchCount[state]++; // a word listed twice counts twice, as with strstr
+    }
+
+    // Breadth-first: failure links, inherited match counts, and missing transitions
+    int head = 0, tail = 0;
+    for (int c = 1; c < acAlphabetSize; c++) {
+        int child = acNext[c];
+        if (child != 0) {
+            fail[child] = 0;
+            queue[tail++] = child;
+        }
+    }
+    while (head < tail) {
+        int state = queue[head++];
+        acMatchCount[state] += acMatchCount[fail[state]];
+        for (int c = 1; c < acAlphabetSize; c++) {
+            int *next = &acNext[state * acAlphabetSize + c];
+            int viaFail = acNext[fail[state] * acAlphabetSize + c];
+            if (*next != 0) {
+                fail[*next] = viaFail;
+                queue[tail++] = *next;
+            } else {
+                *next = viaFail;
+            }
+        }
+    }
+
+    free(fail);
+    free(queue);
+    filterVersion++;
+}
+
+// Prefilter, so most clean messages never reach the automaton. Every filtered word
+// contains an anchor byte (its rarest byte in English text); a message with none of
+// the anchors cannot match, and the test is a few SIMD compares per block, done while
+// case folding. Dictionaries needing too many anchors fall back to a bitmap of each
+// word's first two bytes (first byte for one-letter words) checked at every position.
+#define PREFILTER_ANCHORS 0
+#define PREFILTER_BIGRAMS 1
+
+int prefilterMode;
+int anchorCount;   // distinct anchors the dictionary needs; only the first MAX_ANCHOR_BYTES are stored
+int anchorCompares; // anchorBytes the SIMD loops test: all of them, or none in bigram mode
+unsigned char anchorBytes[MAX_ANCHOR_BYTES];
+unsigned char isAnchorByte[256];
+unsigned char startsOneLetterWord[256];
+uint64_t wordBigrams[65536 / 64]; // bit (first << 8 | second)
+int useAvx2 = 0;
+
+// Higher is rarer: letters by English frequency, anything else rarer than any letter
+int byteRarity(unsigned char c){
+    const char *byFrequency = "etaoinshrdlcumwfgypbvkjxqz";
+    const char *position = c ? strchr(byFrequency, c) : NULL;
+    return position ? (int)(position - byFrequency) : 100;
+}
+
+void buildPrefilter(){
+    memset(isAnchorByte, 0, sizeof(isAnchorByte));
+    memset(startsOneLetterWord, 0, sizeof(startsOneLetterWord));
+    memset(wordBigrams, 0, sizeof(wordBigrams));
+    anchorCount = 0;
+    prefilterMode = PREFILTER_ANCHORS;
+
+    for (int i = 0; i < filteredWordCount; i++) {
+        const unsigned char *word = (const unsigned char *)filteredWords[i];
+        unsigned char rarest = word[0];
+        for (const unsigned char *c = word; *c; c++) {
+            if (byteRarity(*c) > byteRarity(rarest)) {
+                rarest = *c;
+            }
+        }
+        if (!isAnchorByte[rarest]) {
+            isAnchorByte[rarest] = 1;
+            if (anchorCount < MAX_ANCHOR_BYTES) {
+                anchorBytes[anchorCount] = rarest;
+            }
+            anchorCount++;
+        }
+
+        if (word[1] == '\0') {
+            startsOneLetterWord[word[0]] = 1;
+        } else {
+            int bigram = word[0] << 8 | word[1];
+            wordBigrams[bigram / 64] |= 1ULL << (bigram % 64);
+        }
+    }
+
+    anchorCompares = anchorCount;
+    if (anchorCount > MAX_ANCHOR_BYTES) {
+        prefilterMode = PREFILTER_BIGRAMS;
+        anchorCompares = 0;
+    }
+
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    useAvx2 = __builtin_cpu_supports("avx2");
+#endif
+}
+
+// The fold-and-prefilter loops below lowercase ASCII in place up to the terminating
+// '\0' (or capacity bytes) and report whether an anchor byte occurs before it. Bytes
+// past the terminator may be folded too; nothing reads them.
+int foldCaseScalar(char *text, int start, int capacity){
+    int anchorSeen = 0;
+    for (int i = start; i < capacity && text[i]; i++) {
+        unsigned char c = text[i];
+        if (c >= 'A' && c <= 'Z') {
+            c |= 0x20;
+            text[i] = c;
+        }
+        anchorSeen |= isAnchorByte[c];
+    }
+    return anchorSeen;
+}
+
+#ifdef HAVE_X86_SIMD
+int foldCaseSse2(char *text, int capacity){
+    const __m128i beforeA = _mm_set1_epi8('A' - 1);
+    const __m128i afterZ = _mm_set1_epi8('Z' + 1);
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    const __m128i zero = _mm_setzero_si128();
+    int anchorSeen = 0;
+    int i = 0;
+    for (; i + 16 <= capacity; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i isUpper = _mm_and_si128(_mm_cmpgt_epi8(block, beforeA), _mm_cmplt_epi8(block, afterZ));
+        block = _mm_or_si128(block, _mm_and_si128(isUpper, caseBit));
+        _mm_storeu_si128((__m128i *)(text + i), block);
+
+        __m128i hits = zero;
+        for (int k = 0; !anchorSeen && k < anchorCompares; k++) {
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(anchorBytes[k])));
+        }
+        unsigned hitMask = _mm_movemask_epi8(hits);
+        unsigned endMask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, zero));
+        if (endMask) {
+            // Only bytes before the terminator count
+            return anchorSeen || (hitMask & ((endMask & -endMask) - 1)) != 0;
+        }
+        anchorSeen |= hitMask != 0;
+    }
+    return foldCaseScalar(text, i, capacity) || anchorSeen;
+}
+
+__attribute__((target("avx2")))
+int foldCaseAvx2(char *text, int capacity){
+    const __m256i beforeA = _mm256_set1_epi8('A' - 1);
+    const __m256i afterZ = _mm256_set1_epi8('Z' + 1);
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    const __m256i zero = _mm256_setzero_si256();
+    int anchorSeen = 0;
+    int i = 0;
+    for (; i + 32 <= capacity; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(text + i));
+        __m256i isUpper = _mm256_and_si256(_mm256_cmpgt_epi8(block, beforeA), _mm256_cmpgt_epi8(afterZ, block));
+        block = _mm256_or_si256(block, _mm256_and_si256(isUpper, caseBit));
+        _mm256_storeu_si256((__m256i *)(text + i), block);
+
+        __m256i hits = zero;
+        for (int k = 0; !anchorSeen && k < anchorCompares; k++) {
+            hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(anchorBytes[k])));
+        }
+        unsigned hitMask = _mm256_movemask_epi8(hits);
+        unsigned endMask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, zero));
+        if (endMask) {
+            return anchorSeen || (hitMask & ((endMask & -endMask) - 1)) != 0;
+        }
+        anchorSeen |= hitMask != 0;
+    }
+    return foldCaseScalar(text, i, capacity) || anchorSeen;
+}
+#endif
+
+// Lowercase a message in place and say whether it could contain a filtered word.
+// A 0 means scanFilteredWords would find nothing.
+int foldCaseAndPrefilter(char *text, int capacity){
+    int anchorSeen;
+#ifdef HAVE_X86_SIMD
+    anchorSeen = useAvx2 ? foldCaseAvx2(text, capacity) : foldCaseSse2(text, capacity);
+#else
+    anchorSeen = foldCaseScalar(text, 0, capacity);
+#endif
+    if (prefilterMode == PREFILTER_ANCHORS) {
+        return anchorSeen;
+    }
+
+    const unsigned char *p = (const unsigned char *)text;
+    for (int i = 0; i < capacity && p[i]; i++) {
+        int bigram = p[i] << 8 | (i + 1 < capacity ? p[i + 1] : 0);
+        if (startsOneLetterWord[p[i]] || (wordBigrams[bigram / 64] >> (bigram % 64) & 1)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 // Function to read and store filtered words from filtered_words.txt (also stores filteredWordscount for later use)
 void getFilteredWords(FILE * file){
 	
-	char word[MAX_FILTERED_WORD_LENGTH];
-	int filtered_words_count=0;
+	char word[256];
+	int capacity = 64;
 	
-	char tempfilteredWords[50][20];
-	int count=0;
+	filteredWordCount = 0;
+	filteredWords = (char **)malloc(capacity * sizeof(char *));
+	if (filteredWords == NULL) {
+		perror("Memory allocation failed for filtered words");
+		exit(1);
+	}
 	
-	//counts total number of filtered words in file
-	 while( fscanf(file, "%s", word) != EOF){
-	 
-         	filtered_words_count++; 
-         }
-         
-         rewind(file);// takes pointer back to top of file
-         
-         filteredWordCount=filtered_words_count; // giving count value to global variable
-         
-         count=0;
-         
-         filteredWords = (char **)malloc(filteredWordCount * sizeof(char *));
-         //Reads filtered words from file and converts to lowercase and stores them in filteredWords array of strings
-         while(count<filtered_words_count){
-         	filteredWords[count] = (char *)malloc(MAX_FILTERED_WORD_LENGTH * sizeof(char));
-         	fscanf(file, "%s", tempfilteredWords[count]);
-         	filteredWords[count] =tempfilteredWords[count];
-         	toLowerCase(filteredWords[count]);
-         	count++;
-         }
-         
-         fclose(file);
-}
-
-// Function to count violations commited by user in a message and update total violations of the user in TrackViolations[][]
-int countViolations(char *msg, char **filteredWords, int filteredWordCount, int group_id, int user_id) {
-    //if(TrackViolations[group_id][user_id] >= Threshold
-    int count = 0;
+	//Reads filtered words from file, converts them to lowercase and stores them in the filteredWords array of strings
+	while (fscanf(file, "%255s", word) == 1) {
+		if (filteredWordCount == capacity) {
+			capacity *= 2;
+			filteredWords = (char **)realloc(filteredWords, capacity * sizeof(char *));
+			if (filteredWords == NULL) {
+				perror("Memory allocation failed for filtered words");
+				exit(1);
+			}
+		}
+		toLowerCase(word);
+		filteredWords[filteredWordCount] = strdup(word);
+		if (filteredWords[filteredWordCount] == NULL) {
+			perror("Memory allocation failed for filtered word");
+			exit(1);
+		}
+		filteredWordCount++;
+	}
+	
+	fclose(file);
+	
+	buildFilterAutomaton();
+	buildPrefilter();
+}
+
+uint64_t violationKey(int group_id, int user_id){
+    return (((uint64_t)(uint32_t)group_id << 32) | (uint32_t)user_id) + 1;
+}
+
+// Slot of key, or the empty slot where it would go
+size_t findViolationSlot(ViolationTable *table, uint64_t key){
+    size_t mask = table->capacity - 1;
+    size_t i = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+    while (table->keys[i] != 0 && table->keys[i] != key)
+        i = (i + 1) & mask;
+    return i;
+}
+
+void growViolationTable(ViolationTable *table){
+    ViolationTable bigger = *table;
+    bigger.capacity = table->capacity ? table->capacity * 2 : MIN_VIOLATION_SLOTS;
+    bigger.keys = (uint64_t *)calloc(bigger.capacity, sizeof(uint64_t));
+    bigger.counts = (int *)malloc(bigger.capacity * sizeof(int));
+    if (bigger.keys == NULL || bigger.counts == NULL) {
+        perror("Memory allocation failed for violation table");
+        exit(1);
+    }
     
-    // repeats process for each filtered words
-    for (int i = 0; i < filteredWordCount; i++) {
-        const char *p = msg;
-        
-        // Count all occurrences of filteredWords[i] in msg
-        while ((p = strstr(p, filteredWords[i])) != NULL) {
-            count++;  // Found one occurrence
-            p ++;
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (table->keys[i] != 0) {
+            size_t slot = findViolationSlot(&bigger, table->keys[i]);
+            bigger.keys[slot] = table->keys[i];
+            bigger.counts[slot] = table->counts[i];
         }
     }
+    free(table->keys);
+    free(table->counts);
+    *table = bigger;
+}
+
+// Total violations of a user so far (0 if never seen)
+int getViolations(int group_id, int user_id){
+    ViolationTable *table = &violationTables[(unsigned)group_id % numWorkers];
+    if (table->used == 0)
+        return 0;
     
-    TrackViolations[group_id][user_id] += count;
+    size_t slot = findViolationSlot(table, violationKey(group_id, user_id));
+    return table->keys[slot] ? table->counts[slot] : 0;
+}
+
+// Adds count to a user's total and returns the new total
+int addViolations(int group_id, int user_id, int count){
+    ViolationTable *table = &violationTables[(unsigned)group_id % numWorkers];
+    if (count == 0)
+        return getViolations(group_id, user_id);
+    
+    // keep the load under 3/4 so probes stay short
+    if ((table->used + 1) * 4 > table->capacity * 3)
+        growViolationTable(table);
     
-    // Returns 1 if user violations >=Threshold, else 0
-    return (TrackViolations[group_id][user_id] >= Threshold) ? 1 : 0;
+    uint64_t key = violationKey(group_id, user_id);
+    size_t slot = findViolationSlot(table, key);
+    if (table->keys[slot] == 0) {
+        table->keys[slot] = key;
+        table->counts[slot] = 0;
+        table->used++;
+    }
+    table->counts[slot] += count;
+    return table->counts[slot];
 }
 
+// Number of filtered words in a lowercased message, overlapping ones included, in one pass
+int scanFilteredWords(const char *msg){
+    int count = 0;
+    int state = 0;
+    for (const unsigned char *p = (const unsigned char *)msg; *p; p++) {
+        state = acNext[state * acAlphabetSize + acByteClass[*p]];
+        count += acMatchCount[state];
+    }
+    return count;
+}
 
-int main(int argc, char *argv[]) {
+// Chat repeats itself (spam, bots, "ok"), so each worker remembers the filtered word count of
+// recent texts. Entries are keyed by a 64-bit hash and the length of the lowercased text; two
+// different texts would have to collide on both to share a count. Sets are 4-way LRU, most
+// recently used first.
+typedef struct{
+	uint64_t hash;
+	uint32_t length;
+	int count; // -1 marks an empty way
+}ViolationCacheEntry;
+
+typedef struct{
+	ViolationCacheEntry *sets; // VIOLATION_CACHE_SETS * VIOLATION_CACHE_WAYS
+	int version; // filterVersion the entries were counted with
+	long hits;
+	long misses;
+	long evictions;
+}__attribute__((aligned(CACHE_LINE_SIZE))) ViolationCache;
+
+ViolationCache defaultViolationCache;
+ViolationCache *violationCaches=&defaultViolationCache; // indexed like violationTables
+
+static inline uint64_t hashMix(uint64_t a, uint64_t b){
+    __uint128_t product = (__uint128_t)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+// wyhash-style multiply-fold over 8-byte words
+uint64_t hashText(const char *text, size_t length){
+    uint64_t h = 0xa0761d6478bd642fULL ^ length;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, text + i, 8);
+        h = hashMix(h ^ word, 0xe7037ed1a0b428dbULL);
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, text + i, length - i);
+    return hashMix(h ^ tail, 0x8ebc6af09c88c6e3ULL);
+}
+
+void clearViolationCache(ViolationCache *cache){
+    if (cache->sets == NULL) {
+        cache->sets = (ViolationCacheEntry *)aligned_alloc(CACHE_LINE_SIZE, VIOLATION_CACHE_SETS * VIOLATION_CACHE_WAYS * sizeof(ViolationCacheEntry));
+        if (cache->sets == NULL) {
+            perror("Memory allocation failed for violation cache");
+            exit(1);
+        }
+    }
+    for (int i = 0; i < VIOLATION_CACHE_SETS * VIOLATION_CACHE_WAYS; i++)
+        cache->sets[i].count = -1;
+    cache->version = filterVersion;
+}
+
+// Filtered word count of a lowercased message, from the cache when the same text was seen recently
+int cachedFilteredWords(ViolationCache *cache, const char *msg){
+    size_t length = strlen(msg);
+    if (length < VIOLATION_CACHE_MIN_LENGTH)
+        return scanFilteredWords(msg);
     
-    if (argc < 2) { 
-        printf("Usage: %s <test_case_number>\n", argv[0]);
-        return 1;
+    if (cache->sets == NULL || cache->version != filterVersion)
+        clearViolationCache(cache);
+    
+    uint64_t hash = hashText(msg, length);
+    ViolationCacheEntry *set = &cache->sets[(hash & (VIOLATION_CACHE_SETS - 1)) * VIOLATION_CACHE_WAYS];
+    
+    int way = 0;
+    while (way < VIOLATION_CACHE_WAYS && !(set[way].count >= 0 && set[way].hash == hash && set[way].length == length))
+        way++;
+    
+    ViolationCacheEntry entry;
+    if (way < VIOLATION_CACHE_WAYS) {
+        cache->hits++;
+        entry = set[way];
+    } else {
+        cache->misses++;
+        way = VIOLATION_CACHE_WAYS - 1; // least recently used goes
+        if (set[way].count >= 0)
+            cache->evictions++;
+        entry.hash = hash;
+        entry.length = (uint32_t)length;
+        entry.count = scanFilteredWords(msg);
     }
     
+    // move to the front of its set
+    memmove(&set[1], &set[0], way * sizeof(ViolationCacheEntry));
+    set[0] = entry;
+    return entry.count;
+}
+
+// Checks a frame of user messages in order. The group sent them without waiting for earlier
+// verdicts, so this replays what it would have done one message at a time: nothing after a user's
+// removal is counted, and once fewer than two users are left the group would have stopped, so the
+// rest of the frame is discarded.
+void checkBatch(msg *m, verdictMsg *verdicts){
+	int removedUsers[MAX_BATCH_SIZE];
+	int removedCount=0;
+	int activeUsers=m->activeUsers;
+	
+	verdicts->mtype = m->group_id + MAX_GRP_SIZE; // different mtypes for different groups
+	verdicts->count = m->count;
+	char *next = m->entries;
+	for(int i=0;i<m->count;i++){
+		msgEntry *e = (msgEntry *)next;
+		next += MSG_ENTRY_SIZE(e->length);
+		
+		int removed=0;
+		for(int r=0;r<removedCount;r++){
+			if(removedUsers[r]==e->user_id) removed=1;
+		}
+		if(removed || activeUsers<2){
+			verdicts->Delete_user[i]=VERDICT_DISCARDED;
+			continue;
+		}
+		
+		// converts user msg text to lowercase, and only scans it if it could hold a filtered word
+		int violationFlag;
+		// the capacity stops the fold at this entry's NUL, before the next entry's header
+		if (foldCaseAndPrefilter(e->mtext, e->length + 1)) {
+			int count = cachedFilteredWords(&violationCaches[(unsigned)m->group_id % numWorkers], e->mtext);
+			violationFlag = (addViolations(m->group_id, e->user_id, count) >= Threshold) ? 1 : 0;
+		} else {
+			violationFlag = (getViolations(m->group_id, e->user_id) >= Threshold) ? 1 : 0;
+		}
+		verdicts->Delete_user[i]= violationFlag;// 1 if user should be deleted
+		
+		if (violationFlag) {
+			removedUsers[removedCount++]=e->user_id;
+			activeUsers--;
+			
+			// Print status if user is removed
+			printf("User %d from group %d has been removed due to %d violations.\n",
+			       e->user_id, m->group_id, 
+			       getViolations(m->group_id, e->user_id));
+			       fflush(stdout); 
+		} else if (e->userFinished) {
+			activeUsers--;
+		}
+	}
+	
+}
+
+// Checks a frame and sends the verdicts back to its group
+void moderateBatch(msg *m, int msgid){
+	verdictMsg verdicts;
+	checkBatch(m, &verdicts);
+	
+	//send verdicts to groups.c
+	size_t verdictSize = offsetof(verdictMsg, Delete_user) + m->count * sizeof(int) - sizeof(long);
+	if (chatRings != NULL) {
+		chatRingPush(&chatRings->groups[m->group_id].toGroup, &chatRings->groups[m->group_id].groupBell,
+		             &verdicts, verdictSize + sizeof(long));
+		return;
+	}
+	int send_status = msgsnd(msgid, &verdicts, verdictSize, 0);
+	if (send_status == -1) {
+	        perror("msgsnd failed");
+	        exit(1);
+	}
+}
+
+// Worker pool: the receiver hands each frame to worker (group_id % numWorkers), so one
+// group is only ever checked by one thread, in arrival order, and its violation table needs no
+// lock. Each group has at most one frame in flight, so a full queue only means many groups.
+// Frames are checked in their queue slot, which is only handed back once the verdicts are out.
+typedef struct{
+	msg pending[MAX_GRP_SIZE];
+	int head;
+	int count;
+	int stop;
+	pthread_mutex_t mutex;
+	pthread_cond_t notEmpty;
+	pthread_cond_t notFull;
+	pthread_t thread;
+}__attribute__((aligned(CACHE_LINE_SIZE))) ModeratorWorker;
+
+ModeratorWorker *workers=NULL;
+int moderatorQueueId;
+
+void *moderatorWorker(void *arg){
+	ModeratorWorker *worker = (ModeratorWorker *)arg;
+	
+	while(1){
+		pthread_mutex_lock(&worker->mutex);
+		while(worker->count==0 && !worker->stop){
+			pthread_cond_wait(&worker->notEmpty, &worker->mutex);
+		}
+		if(worker->count==0){
+			pthread_mutex_unlock(&worker->mutex);
+			return NULL;
+		}
+		msg *m = &worker->pending[worker->head];
+		pthread_mutex_unlock(&worker->mutex);
+		
+		moderateBatch(m, moderatorQueueId);
+		
+		pthread_mutex_lock(&worker->mutex);
+		worker->head = (worker->head + 1) % MAX_GRP_SIZE;
+		worker->count--;
+		pthread_cond_signal(&worker->notFull);
+		pthread_mutex_unlock(&worker->mutex);
+	}
+}
+
+// size is the frame's length on the wire, mtype included
+void dispatchMessage(msg *m, size_t size){
+	ModeratorWorker *worker = &workers[m->group_id % numWorkers];
+	
+	pthread_mutex_lock(&worker->mutex);
+	while(worker->count==MAX_GRP_SIZE){
+		pthread_cond_wait(&worker->notFull, &worker->mutex);
+	}
+	memcpy(&worker->pending[(worker->head + worker->count) % MAX_GRP_SIZE], m, size);
+	worker->count++;
+	pthread_cond_signal(&worker->notEmpty);
+	pthread_mutex_unlock(&worker->mutex);
+}
+
+// one violation table and text cache per worker
+void allocateWorkerState(){
+	violationTables = (ViolationTable *)aligned_alloc(CACHE_LINE_SIZE, numWorkers * sizeof(ViolationTable));
+	violationCaches = (ViolationCache *)aligned_alloc(CACHE_LINE_SIZE, numWorkers * sizeof(ViolationCache));
+	if (violationTables == NULL || violationCaches == NULL) {
+		perror("Memory allocation failed for workers");
+		exit(1);
+	}
+	
+	memset(violationTables, 0, numWorkers * sizeof(ViolationTable));
+	memset(violationCaches, 0, numWorkers * sizeof(ViolationCache));
+}
+
+void startWorkers(){
+	workers = (ModeratorWorker *)aligned_alloc(CACHE_LINE_SIZE, numWorkers * sizeof(ModeratorWorker));
+	if (workers == NULL) {
+		perror("Memory allocation failed for workers");
+		exit(1);
+	}
+	
+	allocateWorkerState();
+	for(int i=0;i<numWorkers;i++){
+		workers[i].head=0;
+		workers[i].count=0;
+		workers[i].stop=0;
+		pthread_mutex_init(&workers[i].mutex, NULL);
+		pthread_cond_init(&workers[i].notEmpty, NULL);
+		pthread_cond_init(&workers[i].notFull, NULL);
+		if (pthread_create(&workers[i].thread, NULL, moderatorWorker, &workers[i]) != 0) {
+			perror("pthread_create failed");
+			exit(1);
+		}
+	}
+}
+
+void stopWorkers(){
+	for(int i=0;i<numWorkers;i++){
+		pthread_mutex_lock(&workers[i].mutex);
+		workers[i].stop=1;
+		pthread_cond_signal(&workers[i].notEmpty);
+		pthread_mutex_unlock(&workers[i].mutex);
+	}
+	for(int i=0;i<numWorkers;i++){
+		pthread_join(workers[i].thread, NULL);
+	}
+	free(workers);
+}
+
+// Next frame from any group's ring, taking the groups in turn so none is starved; returns its size
+int receiveFromRings(msg *m){
+	static int nextGroup=0;
+	
+	for(int spins=0;;spins++){
+		for(int i=0;i<CHAT_RING_GROUPS;i++){
+			int g=(nextGroup+i)%CHAT_RING_GROUPS;
+			int size=chatRingTryPop(&chatRings->groups[g].toModerator, m, sizeof(*m));
+			if(size>=0){
+				nextGroup=(g+1)%CHAT_RING_GROUPS;
+				return size;
+			}
+		}
+		if(spins<chatRingSpinLimit()){
+			chatRingRelax();
+			continue;
+		}
+		
+		uint32_t seen=chatDoorbellArm(&chatRings->moderatorBell);
+		int ready=0;
+		for(int g=0;g<CHAT_RING_GROUPS && !ready;g++){
+			ready=!chatRingEmpty(&chatRings->groups[g].toModerator);
+		}
+		chatDoorbellWait(&chatRings->moderatorBell, seen, ready);
+		spins=0;
+	}
+}
+
+// Reads the testcase's filtered words and input.txt; returns the groups/moderator queue key
+int loadModeratorInput(const char *testcase){
     //to read from the filteredwords.txt file of X test case
     FILE *file;
     char filepath[256];
     
-    snprintf(filepath, sizeof(filepath), "testcase_%s/filtered_words.txt", argv[1]);
+    snprintf(filepath, sizeof(filepath), "testcase_%s/filtered_words.txt", testcase);
     file = fopen(filepath, "r");
     if (file == NULL) {
         perror("Error opening file");
-        return EXIT_FAILURE;
+        exit(1);
     }
     
     //calls function by giving the opened filteredwords.txt file pointer
@@ -165,15 +803,56 @@ int main(int argc, char *argv[]) {
     FILE *file1;
     char filepath1[256];
     
-    snprintf(filepath1, sizeof(filepath1), "testcase_%s/input.txt", argv[1]);
+    snprintf(filepath1, sizeof(filepath1), "testcase_%s/input.txt", testcase);
     file1 = fopen(filepath1, "r");
     if (file1 == NULL) {
         perror("Error opening file");
-        return EXIT_FAILURE;
+        exit(1);
     }
     
     //calling function using file pointer of input.txt
-    int ipc_key=getInputParameters(file1);
+    return getInputParameters(file1);
+}
+
+void printViolationCacheStats(){
+    long hits=0, misses=0, evictions=0;
+    for(int i=0;i<numWorkers;i++){
+    	hits+=violationCaches[i].hits;
+    	misses+=violationCaches[i].misses;
+    	evictions+=violationCaches[i].evictions;
+    }
+    fprintf(stderr, "Violation cache: %ld hits, %ld misses (%.1f%% hit rate), %ld evictions\n",
+            hits, misses, hits + misses ? 100.0 * hits / (hits + misses) : 0.0, evictions);
+}
+
+// app.c's threaded runtime (built with -DCHAT_THREADS) checks frames here, on the group's own
+// thread. Every group id below MAX_GRP_SIZE gets its own table and cache, so no locking.
+void startInProcessModeration(const char *testcase){
+	loadModeratorInput(testcase);
+	numWorkers = MAX_GRP_SIZE;
+	allocateWorkerState();
+}
+
+// size is the frame's length with mtype, as on the queue. The check lowercases texts in place, so
+// it works on a copy: the group still sends the originals to validation.out.
+void moderateInProcess(const void *frame, size_t size, void *verdicts){
+	msg copy;
+	memcpy(&copy, frame, size);
+	checkBatch(&copy, (verdictMsg *)verdicts);
+}
+
+#ifdef CHAT_THREADS
+#define main moderator_main // app.c has the program's main
+#endif
+
+int main(int argc, char *argv[]) {
+    
+    if (argc < 2) { 
+        printf("Usage: %s <test_case_number> [worker_threads]\n", argv[0]);
+        return 1;
+    }
+    
+    int ipc_key=loadModeratorInput(argv[1]);
     
     //generate or access message queue
 	int msgid = msgget(ipc_key, 0666 | IPC_CREAT);
@@ -182,6 +861,23 @@ int main(int argc, char *argv[]) {
 		exit(1);
     	}
     	
+    	moderatorQueueId=msgid;
+    	
+    	// CHAT_TRANSPORT=shm: frames and verdicts go through shared memory rings instead of the queue
+    	if (chatRingsSelected()) {
+    		chatRings = createChatRings(ipc_key);
+    	}
+    	
+    	// optional worker pool; more workers than groups would only sit idle
+    	if (argc > 2) {
+    		numWorkers = atoi(argv[2]);
+    		if (numWorkers > NumberOfGroups) numWorkers = NumberOfGroups;
+    		if (numWorkers < 1) numWorkers = 1;
+    	}
+    	if (numWorkers > 1) {
+    		startWorkers();
+    	}
+    	
     	//To track no.of active groups left
 	int activeGroups=NumberOfGroups;
 	
@@ -190,12 +886,17 @@ int main(int argc, char *argv[]) {
 		printf("\n");
 	
 		// Receiving message from groups.c 
-		int receive_status= msgrcv(msgid, &message, sizeof(message) - sizeof(long), 1, 0);
-		//printf("receive success: msg text: %s\n",message.mtext);
-		if (receive_status == -1) {
-			perror("msgrcv failed");
-			exit(1);
-	    	}
+		size_t frameSize;
+		if (chatRings != NULL) {
+			frameSize = receiveFromRings(&message);
+		} else {
+			int receive_status= msgrcv(msgid, &message, sizeof(message) - sizeof(long), 1, 0);
+			if (receive_status == -1) {
+				perror("msgrcv failed");
+				exit(1);
+		    	}
+			frameSize = receive_status + sizeof(long);
+		}
 	    	
 	    	//updates number of active groups left (i.e if a group is terminated then it sends a message with Group_status set as 1
 	    	activeGroups=activeGroups-message.Group_status;
@@ -211,29 +912,21 @@ int main(int argc, char *argv[]) {
 				continue;
 		}
 		
-	    	toLowerCase(message.mtext); // converts user msg text to lowercase
-	    	int violationFlag = countViolations(message.mtext, filteredWords, filteredWordCount, message.group_id, message.user_id);
-	    	//printf("violation flag status: %d\n",violationFlag);
-	    	message.mtype = message.group_id + MAX_GRP_SIZE; // different mtypes for different groups
-		message.Delete_user= violationFlag;// 1 if user should be deleted
-		
-		msg message1=message;
-		//send message to groups.c
-		int send_status = msgsnd(msgid, &message1, sizeof(message1) - sizeof(long), 0);
-		//printf("sent success: \n");
-		if (send_status == -1) {
-		        perror("msgsnd failed");
-		        exit(1);
-		}
-		
-		// Print status if user is removed
-		if (violationFlag) {
-		    printf("User %d from group %d has been removed due to %d violations.\n",
-		           message.user_id, message.group_id, 
-		           TrackViolations[message.group_id][message.user_id]);
-		           fflush(stdout); 
-		}
+	    	if (numWorkers > 1) {
+	    		dispatchMessage(&message, frameSize);
+	    	} else {
+	    		moderateBatch(&message, msgid);
+	    	}
         }
     
+    if (numWorkers > 1) {
+    	stopWorkers();
+    }
+    if (chatRings != NULL) {
+    	removeChatRings(ipc_key);
+    }
+    
+    printViolationCacheStats();
+    
     return 0;
 }
@@ -0,0 +1,285 @@
+// Benchmarks the moderator's violation counting against the original strstr loop, and
+// the whole per-message path (case folding, prefilter, counting) on chat-like text.
+// Build: gcc -O2 -pthread -o moderator_bench moderator_bench.c
+// Run:   ./moderator_bench [messages]
+#define main moderator_main
+#include "moderator.c"
+#undef main
+
+#include <time.h>
+
+// The original countViolations loop: one strstr scan of the message per filtered word
+int countViolationsStrstr(const char *msg) {
+    int count = 0;
+    for (int i = 0; i < filteredWordCount; i++) {
+        const char *p = msg;
+        while ((p = strstr(p, filteredWords[i])) != NULL) {
+            count++;
+            p++;
+        }
+    }
+    return count;
+}
+
+unsigned int benchSeed = 12345;
+
+int benchRandom(int n) {
+    benchSeed = benchSeed * 1103515245 + 12345;
+    return (benchSeed >> 8) % n;
+}
+
+void randomWord(char *out, int minLength, int maxLength) {
+    int length = minLength + benchRandom(maxLength - minLength + 1);
+    for (int i = 0; i < length; i++) {
+        out[i] = 'a' + benchRandom(26);
+    }
+    out[length] = '\0';
+}
+
+// Common chat words; a clean message is a few of these, mixed case
+const char *chatWords[] = {
+    "ok", "OK", "lol", "hi", "Hello", "yes", "no", "thanks", "see", "you", "at", "the", "meeting",
+    "tomorrow", "sure", "what", "time", "is", "it", "on", "my", "way", "good", "morning", "night",
+    "where", "are", "we", "going", "today", "sounds", "great", "I", "will", "call", "later"
+};
+
+void chatMessage(char *out, int dirty) {
+    int words = 1 + benchRandom(6);
+    int length = 0;
+    for (int i = 0; i < words; i++) {
+        const char *word = (dirty && i == words - 1) ? filteredWords[benchRandom(filteredWordCount)]
+                                                     : chatWords[benchRandom(sizeof(chatWords) / sizeof(chatWords[0]))];
+        if (i > 0) {
+            out[length++] = '_';
+        }
+        strcpy(out + length, word);
+        length += strlen(word);
+    }
+    memset(out + length, 0, MAX_TEXT_SIZE - length);
+}
+
+double secondsSince(struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    int numMessages = argc > 1 ? atoi(argv[1]) : 20000;
+    int wordCounts[] = {50, 1000, 100000};
+
+    // Chat-like messages: short words, some of them filtered
+    char (*messages)[MAX_TEXT_SIZE] = malloc((size_t)numMessages * MAX_TEXT_SIZE);
+    if (messages == NULL) {
+        perror("Memory allocation failed for messages");
+        return 1;
+    }
+
+    for (int w = 0; w < 3; w++) {
+        filteredWordCount = wordCounts[w];
+        filteredWords = (char **)malloc(filteredWordCount * sizeof(char *));
+        for (int i = 0; i < filteredWordCount; i++) {
+            char word[16];
+            randomWord(word, 4, 8);
+            filteredWords[i] = strdup(word);
+        }
+        buildFilterAutomaton();
+        buildPrefilter();
+
+        for (int m = 0; m < numMessages; m++) {
+            int length = 0;
+            while (length < 100) {
+                char word[16];
+                if (benchRandom(20) == 0) {
+                    strcpy(word, filteredWords[benchRandom(filteredWordCount)]);
+                } else {
+                    randomWord(word, 1, 7);
+                }
+                int wordLength = strlen(word);
+                memcpy(messages[m] + length, word, wordLength);
+                length += wordLength;
+                messages[m][length++] = '_';
+            }
+            messages[m][length] = '\0';
+        }
+
+        // Both must agree on every message
+        struct timespec start;
+        long long automatonTotal = 0, strstrTotal = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int m = 0; m < numMessages; m++) {
+            int count = scanFilteredWords(messages[m]);
+            addViolations(0, 0, count);
+            automatonTotal += count;
+        }
+        double automatonSeconds = secondsSince(&start);
+
+        // The strstr loop is far slower with big dictionaries, so time it on fewer messages
+        int strstrMessages = filteredWordCount > 1000 ? numMessages / 100 : numMessages;
+        long long automatonSubset = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int m = 0; m < strstrMessages; m++) {
+            strstrTotal += countViolationsStrstr(messages[m]);
+        }
+        double strstrSeconds = secondsSince(&start);
+        for (int m = 0; m < strstrMessages; m++) {
+            automatonSubset += scanFilteredWords(messages[m]);
+        }
+
+        printf("%6d words: automaton %8.1f ns/msg (%d states), strstr %10.1f ns/msg, %s (%lld hits)\n",
+               filteredWordCount, automatonSeconds * 1e9 / numMessages, acStateCount,
+               strstrSeconds * 1e9 / strstrMessages,
+               automatonSubset == strstrTotal ? "counts match" : "COUNTS DIFFER", automatonTotal);
+
+        // Whole message path on 20-byte-ish chat lines: every 20th one has a filtered word
+        char (*original)[MAX_TEXT_SIZE] = malloc((size_t)numMessages * MAX_TEXT_SIZE);
+        char (*work)[MAX_TEXT_SIZE] = malloc((size_t)numMessages * MAX_TEXT_SIZE);
+        for (int dirtyEvery = 0; dirtyEvery <= 20; dirtyEvery += 20) {
+            for (int m = 0; m < numMessages; m++) {
+                chatMessage(original[m], dirtyEvery && m % dirtyEvery == 0);
+            }
+            int pathMessages = filteredWordCount > 1000 ? numMessages / 100 : numMessages;
+
+            memcpy(work, original, (size_t)numMessages * MAX_TEXT_SIZE);
+            long long oldTotal = 0;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (int m = 0; m < pathMessages; m++) {
+                for (int i = 0; work[m][i]; i++) {
+                    work[m][i] = tolower(work[m][i]);
+                }
+                oldTotal += countViolationsStrstr(work[m]);
+            }
+            double oldSeconds = secondsSince(&start);
+
+            memcpy(work, original, (size_t)numMessages * MAX_TEXT_SIZE);
+            long long newTotal = 0, newSubset = 0;
+            int scanned = 0;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (int m = 0; m < numMessages; m++) {
+                if (foldCaseAndPrefilter(work[m], MAX_TEXT_SIZE)) {
+                    int count = scanFilteredWords(work[m]);
+                    addViolations(0, 0, count);
+                    newTotal += count;
+                    scanned++;
+                }
+                if (m == pathMessages - 1) {
+                    newSubset = newTotal;
+                }
+            }
+            double newSeconds = secondsSince(&start);
+
+            // Same again through the per-worker text cache
+            memcpy(work, original, (size_t)numMessages * MAX_TEXT_SIZE);
+            ViolationCache *cache = &violationCaches[0];
+            long hitsBefore = cache->hits, missesBefore = cache->misses;
+            long long cachedTotal = 0;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (int m = 0; m < numMessages; m++) {
+                if (foldCaseAndPrefilter(work[m], MAX_TEXT_SIZE)) {
+                    cachedTotal += cachedFilteredWords(cache, work[m]);
+                }
+            }
+            double cachedSeconds = secondsSince(&start);
+            long hits = cache->hits - hitsBefore, lookups = hits + cache->misses - missesBefore;
+
+            printf("        %s chat: tolower+strstr %8.1f ns/msg, fold+prefilter+automaton %6.1f ns/msg "
+                   "(%s, %d anchors, %.1f%% scanned), %s\n",
+                   dirtyEvery ? "5% dirty" : "   clean", oldSeconds * 1e9 / pathMessages,
+                   newSeconds * 1e9 / numMessages, prefilterMode == PREFILTER_ANCHORS ? "anchors" : "bigrams",
+                   anchorCount, 100.0 * scanned / numMessages,
+                   newSubset == oldTotal ? "counts match" : "COUNTS DIFFER");
+            printf("                        with text cache %6.1f ns/msg (%.1f%% hits), %s\n",
+                   cachedSeconds * 1e9 / numMessages, lookups ? 100.0 * hits / lookups : 0.0,
+                   cachedTotal == newTotal ? "counts match" : "COUNTS DIFFER");
+        }
+        // Repetitive traffic: half the messages are copies from a pool of 200 long texts (spam, bots)
+        for (int m = 0; m < numMessages; m++) {
+            int length = 0;
+            unsigned int savedSeed = benchSeed;
+            int fromPool = benchRandom(2) == 0;
+            if (fromPool) {
+                benchSeed = 777 + benchRandom(200);
+            }
+            int target = 48 + benchRandom(200);
+            while (length < target) {
+                const char *word = chatWords[benchRandom(sizeof(chatWords) / sizeof(chatWords[0]))];
+                if (benchRandom(20) == 0) {
+                    word = filteredWords[benchRandom(filteredWordCount)];
+                }
+                int wordLength = strlen(word);
+                if (length + wordLength + 1 >= MAX_TEXT_SIZE) {
+                    break;
+                }
+                memcpy(original[m] + length, word, wordLength);
+                length += wordLength;
+                original[m][length++] = '_';
+            }
+            memset(original[m] + length, 0, MAX_TEXT_SIZE - length);
+            if (fromPool) {
+                benchSeed = savedSeed;
+                benchRandom(2);
+            }
+        }
+        double spamSeconds[2];
+        long long spamTotal[2] = {0, 0};
+        ViolationCache *cache = &violationCaches[0];
+        long hitsBefore = cache->hits, missesBefore = cache->misses;
+        for (int useCache = 0; useCache < 2; useCache++) {
+            memcpy(work, original, (size_t)numMessages * MAX_TEXT_SIZE);
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (int m = 0; m < numMessages; m++) {
+                if (foldCaseAndPrefilter(work[m], MAX_TEXT_SIZE)) {
+                    spamTotal[useCache] += useCache ? cachedFilteredWords(cache, work[m]) : scanFilteredWords(work[m]);
+                }
+            }
+            spamSeconds[useCache] = secondsSince(&start);
+        }
+        long hits = cache->hits - hitsBefore, lookups = hits + cache->misses - missesBefore;
+        printf("       repetitive chat: automaton %6.1f ns/msg, with text cache %6.1f ns/msg (%.1f%% hits), %s\n",
+               spamSeconds[0] * 1e9 / numMessages, spamSeconds[1] * 1e9 / numMessages,
+               lookups ? 100.0 * hits / lookups : 0.0,
+               spamTotal[0] == spamTotal[1] ? "counts match" : "COUNTS DIFFER");
+
+        free(original);
+        free(work);
+
+        for (int i = 0; i < filteredWordCount; i++) {
+            free(filteredWords[i]);
+        }
+        free(filteredWords);
+        free(acNext);
+        free(acMatchCount);
+    }
+
+    free(messages);
+
+    // Violation store: lookups should cost the same however many users have violations
+    int userCounts[] = {1000, 100000, 500000};
+    for (int u = 0; u < 3; u++) {
+        ViolationTable empty = {0};
+        free(violationTables[0].keys);
+        free(violationTables[0].counts);
+        violationTables[0] = empty;
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < userCounts[u]; i++) {
+            addViolations(i % 30, i / 30, 1 + i % 3);
+        }
+        double addSeconds = secondsSince(&start);
+
+        long long lookups = 2000000, total = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (long long i = 0; i < lookups; i++) {
+            int user = benchRandom(userCounts[u]);
+            total += getViolations(user % 30, user / 30);
+        }
+        double getSeconds = secondsSince(&start);
+
+        printf("%6d users: add %5.1f ns, lookup %5.1f ns, %zu slots (%.1f MB), checksum %lld\n",
+               userCounts[u], addSeconds * 1e9 / userCounts[u], getSeconds * 1e9 / lookups,
+               violationTables[0].capacity,
+               violationTables[0].capacity * (sizeof(uint64_t) + sizeof(int)) / 1e6, total);
+    }
+    return 0;
+}
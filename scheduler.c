@@ -8,11 +8,46 @@
 #include <sys/shm.h>
 #include <stdbool.h>
 #include <pthread.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stddef.h>
 
 #define MAX_CARGO_COUNT 200
 #define MAX_NEW_REQUESTS 100
-#define MAX_DOCKS 30
+#define MAX_DOCKS 30 // Auth string slots in the shared memory of a regular port
 #define MAX_SHIP_REQUESTS 1100
+#define SHIP_TABLE_SIZE 4096 // Power of two, comfortably above 2 * MAX_SHIP_REQUESTS
+
+// Cargo planning runs on a worker pool once a timestep has this many docks to plan
+#define PARALLEL_PLANNING_MIN_DOCKS 64
+#define MAX_PLANNING_THREADS 64
+
+// Order in which auth-string candidates are tried
+#define GUESS_ORDER_LEXICOGRAPHIC 0
+#define GUESS_ORDER_HISTORY 1
+
+// Background auth-string search state of a dock
+#define AUTH_SEARCH_IDLE 0
+#define AUTH_SEARCH_PENDING 1
+#define AUTH_SEARCH_DONE 2
+#define AUTH_SEARCH_FAILED 3
+
+// Batched guess verification, an extension to the solver protocol. A solver that
+// supports it answers a batch (or an empty probe) with the index of the correct
+// candidate; solvers that do not never read the batch message type.
+#define SOLVER_BATCH_REQUEST 4
+#define SOLVER_BATCH_RESPONSE 5
+#define BATCH_GUESS_BYTES 4000
+#define SOLVER_PROBE_TIMEOUT_MS 50
+
+// Memory ceiling for all cached auth-string candidate tables; longer strings are decoded on the fly
+#ifndef AUTH_TABLE_MEMORY_LIMIT
+#define AUTH_TABLE_MEMORY_LIMIT (64LL * 1024 * 1024)
+#endif
+
+struct GuessPlan;
 
 typedef struct {
     int dockId;
@@ -20,7 +55,11 @@ typedef struct {
     int threadId;
     int numThreads;
     int stringLength;
+    struct GuessPlan *plan;
     bool success;
+    long long foundSeq;
+    long long guessesSent;
+    long long resumeFrom; // first candidate to try when resuming a checkpointed search, or -1
     char authString[100];
 } ThreadData;
 
@@ -35,10 +74,9 @@ typedef struct ShipRequest {
     int cargo[MAX_CARGO_COUNT];
 } ShipRequest;
 
-typedef struct MainSharedMemory {
-    char authStrings[MAX_DOCKS][100];
-    ShipRequest newShipRequests[MAX_NEW_REQUESTS];
-} MainSharedMemory;
+// Shared memory layout: char authStrings[authStringSlots][100] followed by
+// ShipRequest newShipRequests[MAX_NEW_REQUESTS]. Regular ports use MAX_DOCKS
+// slots; ports with more docks get one slot per dock.
 
 typedef struct MessageStruct {
     long mtype;
@@ -65,6 +103,23 @@ typedef struct SolverResponse {
     int guessIsCorrect;
 } SolverResponse;
 
+typedef struct BatchSolverRequest {
+    long mtype;
+    int dockId;
+    int stringLength;
+    int count; // candidates packed back to back, stringLength bytes each, no terminators
+    char guesses[BATCH_GUESS_BYTES];
+} BatchSolverRequest;
+
+typedef struct BatchSolverResponse {
+    long mtype;
+    int matchIndex; // index of the correct candidate in the batch, or -1
+} BatchSolverResponse;
+
+// Only the used part of guesses is sent
+#define BATCH_REQUEST_SIZE(count, length) \
+    (offsetof(BatchSolverRequest, guesses) - sizeof(long) + (size_t)(count) * (length))
+
 typedef struct Dock {
     int id;
     int category;
@@ -76,6 +131,18 @@ typedef struct Dock {
     int lastCargoMovedTimestep;
     bool allCargoMoved;
     int maxCraneCapacity; // Added to track max crane capacity
+    int *craneUsedTimestep; // Last timestep each crane moved cargo
+    int *plannedCargo;      // Cargo moves planned this round, at most one per crane
+    int *plannedCranes;
+    int plannedCount;
+    int rank;               // Position in dock preference order (category, then id)
+    int authSearchState;  // AUTH_SEARCH_* state of the background search for this dock
+    int authStringLength;
+    long long authSearchAfterMessage; // outbound messages that must be sent before solving
+    char foundAuthString[100];
+    struct Ship *ship;    // Ship occupying the dock, valid while isOccupied
+    long long authCursor[8]; // Candidate each solver thread is on, published for checkpoints
+    bool authResume;         // Next search continues from authCursor
 } Dock;
 
 typedef struct Ship {
@@ -94,14 +161,19 @@ typedef struct Ship {
     int cargosMovedCount;
     int maxCargoWeight; // Added to track max cargo weight
     int priority;       // Added to help prioritize ships
+    int index;          // Position in ships[]
+    uint64_t *compatibleDocks; // Bit per dock rank: category and crane capacity fit this ship
 } Ship;
 
 // Global variables
 int mainQueueId;
 int shmId;
-MainSharedMemory *sharedMemory;
+char *sharedMemory;
+int authStringSlots;
 int solverQueueIds[8];
 int numSolvers;
+bool batchGuesses = false;        // --batch-guesses: offer the batched protocol to the solvers
+bool solverTakesBatches[8];       // solvers that answered the batch probe
 int numDocks;
 Dock *docks;
 Ship *ships[MAX_SHIP_REQUESTS];
@@ -109,9 +181,309 @@ int shipCount = 0;
 int currentTimestep = 1;
 MessageStruct globalMessage;
 
+// Set of small integer ids with O(1) add and remove; position[id] is the slot of id or -1
+typedef struct IdSet {
+    int *ids;
+    int *position;
+    int count;
+} IdSet;
+
+// Activity tracking, so each phase of a timestep only touches docks and ships that can change
+IdSet occupiedDocks;   // docks with a ship
+IdSet completedDocks;  // occupied docks whose ship has moved all its cargo
+IdSet waitingShips;    // ships (by index) waiting for a dock and not yet expired
+IdSet arrivedShips;    // ships that arrived or returned this timestep
+int unservicedShipCount = 0;
+Ship *shipTable[SHIP_TABLE_SIZE]; // open addressing on (id, direction)
+
+// Dock bitsets are indexed by rank, so the first set bit is the smallest adequate dock
+int dockWords;
+int *dockAtRank;
+uint64_t *freeDockBits;
+
+void initIdSet(IdSet *set, int capacity) {
+    set->ids = (int *)malloc(capacity * sizeof(int));
+    set->position = (int *)malloc(capacity * sizeof(int));
+    if (set->ids == NULL || set->position == NULL) {
+        perror("Memory allocation failed for id set");
+        exit(1);
+    }
+    for (int i = 0; i < capacity; i++) {
+        set->position[i] = -1;
+    }
+    set->count = 0;
+}
+
+void addToIdSet(IdSet *set, int id) {
+    if (set->position[id] != -1) {
+        return;
+    }
+    set->position[id] = set->count;
+    set->ids[set->count++] = id;
+}
+
+void removeFromIdSet(IdSet *set, int id) {
+    int slot = set->position[id];
+    if (slot == -1) {
+        return;
+    }
+    int last = set->ids[--set->count];
+    set->ids[slot] = last;
+    set->position[last] = slot;
+    set->position[id] = -1;
+}
+
+void clearIdSet(IdSet *set) {
+    for (int i = 0; i < set->count; i++) {
+        set->position[set->ids[i]] = -1;
+    }
+    set->count = 0;
+}
+
+int compareIds(const void *a, const void *b) {
+    return *(const int *)a - *(const int *)b;
+}
+
+// Copy the ids into out in ascending order, so phases keep visiting docks and ships in index order
+int sortedIdSet(IdSet *set, int *out) {
+    memcpy(out, set->ids, set->count * sizeof(int));
+    qsort(out, set->count, sizeof(int), compareIds);
+    return set->count;
+}
+
+int shipTableSlot(int shipId, int direction) {
+    unsigned int hash = (unsigned int)shipId * 2654435761u ^ (direction == 1 ? 0x9e3779b9u : 0);
+    int slot = hash & (SHIP_TABLE_SIZE - 1);
+    while (shipTable[slot] != NULL &&
+           (shipTable[slot]->id != shipId || shipTable[slot]->direction != direction)) {
+        slot = (slot + 1) & (SHIP_TABLE_SIZE - 1);
+    }
+    return slot;
+}
+
+Ship *shipAtDock(Dock *dock) {
+    return dock->isOccupied ? dock->ship : NULL;
+}
+
+void markShipServiced(Ship *ship) {
+    if (!ship->isServiced) {
+        unservicedShipCount--;
+    }
+    ship->isServiced = true;
+    ship->isAssignedDock = false;
+}
+
 volatile bool authStringFound = false;
 pthread_mutex_t authMutex = PTHREAD_MUTEX_INITIALIZER;
 
+// Outbound messages to the validation module, sent in FIFO order by a dedicated sender thread
+typedef struct OutboundQueue {
+    MessageStruct *messages;
+    int capacity;
+    int head;
+    int count;
+    long long queuedTotal; // messages ever queued
+    long long sentTotal;   // messages ever handed to msgsnd
+    long long releasedTotal; // messages allowed out; the rest are held for a checkpoint
+    long long *sentCounter;  // checkpoint counter bumped after each msgsnd, or NULL
+    bool holding;
+    bool stopping;
+    pthread_t senderThread;
+    pthread_mutex_t mutex;
+    pthread_cond_t notEmpty;
+    pthread_cond_t sent;
+} OutboundQueue;
+
+OutboundQueue outboundQueue = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .notEmpty = PTHREAD_COND_INITIALIZER,
+    .sent = PTHREAD_COND_INITIALIZER
+};
+
+const char *outboundErrorMessage(long mtype) {
+    switch (mtype) {
+        case 2: return "Error sending dock assignment message";
+        case 3: return "Error sending undock message";
+        case 4: return "Error sending cargo movement message";
+        case 5: return "Error sending timestep update message";
+        case 6: return "Error sending completion message";
+        default: return "Error sending message to validation";
+    }
+}
+
+void* outboundSender(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&outboundQueue.mutex);
+    while (true) {
+        while ((outboundQueue.count == 0 || outboundQueue.sentTotal >= outboundQueue.releasedTotal) &&
+               !outboundQueue.stopping) {
+            pthread_cond_wait(&outboundQueue.notEmpty, &outboundQueue.mutex);
+        }
+        if (outboundQueue.count == 0) {
+            break;
+        }
+
+        // Send a copy so the queue can grow while we are blocked in msgsnd
+        MessageStruct message = outboundQueue.messages[outboundQueue.head];
+        pthread_mutex_unlock(&outboundQueue.mutex);
+
+        if (msgsnd(mainQueueId, &message, sizeof(MessageStruct) - sizeof(long), 0) == -1) {
+            perror(outboundErrorMessage(message.mtype));
+            exit(1);
+        }
+        if (outboundQueue.sentCounter != NULL) {
+            __atomic_add_fetch(outboundQueue.sentCounter, 1, __ATOMIC_RELEASE);
+        }
+
+        pthread_mutex_lock(&outboundQueue.mutex);
+        outboundQueue.head = (outboundQueue.head + 1) % outboundQueue.capacity;
+        outboundQueue.count--;
+        outboundQueue.sentTotal++;
+        pthread_cond_broadcast(&outboundQueue.sent);
+    }
+    pthread_mutex_unlock(&outboundQueue.mutex);
+    return NULL;
+}
+
+void startOutboundSender() {
+    outboundQueue.capacity = 256;
+    outboundQueue.messages = (MessageStruct *)malloc(outboundQueue.capacity * sizeof(MessageStruct));
+    if (outboundQueue.messages == NULL) {
+        perror("Memory allocation failed for outbound queue");
+        exit(1);
+    }
+    outboundQueue.head = 0;
+    outboundQueue.count = 0;
+    outboundQueue.queuedTotal = 0;
+    outboundQueue.sentTotal = 0;
+    outboundQueue.releasedTotal = LLONG_MAX;
+    outboundQueue.sentCounter = NULL;
+    outboundQueue.holding = false;
+    outboundQueue.stopping = false;
+
+    if (pthread_create(&outboundQueue.senderThread, NULL, outboundSender, NULL) != 0) {
+        perror("Failed to create outbound sender thread");
+        exit(1);
+    }
+}
+
+// Queue a message for the validation module; it is sent after every message queued before it
+void queueMainMessage(MessageStruct *message) {
+    pthread_mutex_lock(&outboundQueue.mutex);
+
+    if (outboundQueue.count == outboundQueue.capacity) {
+        // Grow and unwrap the ring so the pending messages stay in order
+        int newCapacity = outboundQueue.capacity * 2;
+        MessageStruct *grown = (MessageStruct *)malloc(newCapacity * sizeof(MessageStruct));
+        if (grown == NULL) {
+            perror("Memory allocation failed for outbound queue");
+            exit(1);
+        }
+        for (int i = 0; i < outboundQueue.count; i++) {
+            grown[i] = outboundQueue.messages[(outboundQueue.head + i) % outboundQueue.capacity];
+        }
+        free(outboundQueue.messages);
+        outboundQueue.messages = grown;
+        outboundQueue.capacity = newCapacity;
+        outboundQueue.head = 0;
+    }
+
+    int tail = (outboundQueue.head + outboundQueue.count) % outboundQueue.capacity;
+    outboundQueue.messages[tail] = *message;
+    outboundQueue.count++;
+    outboundQueue.queuedTotal++;
+
+    pthread_cond_signal(&outboundQueue.notEmpty);
+    pthread_mutex_unlock(&outboundQueue.mutex);
+}
+
+long long outboundQueuedTotal() {
+    pthread_mutex_lock(&outboundQueue.mutex);
+    long long total = outboundQueue.queuedTotal;
+    pthread_mutex_unlock(&outboundQueue.mutex);
+    return total;
+}
+
+// Messages queued so far that the sender may send; while holding, the ones queued since the
+// last release are not counted
+long long outboundReleasedTotal() {
+    pthread_mutex_lock(&outboundQueue.mutex);
+    long long total = outboundQueue.queuedTotal < outboundQueue.releasedTotal ?
+                      outboundQueue.queuedTotal : outboundQueue.releasedTotal;
+    pthread_mutex_unlock(&outboundQueue.mutex);
+    return total;
+}
+
+// Block until the first `total` queued messages have been handed to the kernel
+void waitOutboundSent(long long total) {
+    pthread_mutex_lock(&outboundQueue.mutex);
+    while (outboundQueue.sentTotal < total) {
+        pthread_cond_wait(&outboundQueue.sent, &outboundQueue.mutex);
+    }
+    pthread_mutex_unlock(&outboundQueue.mutex);
+}
+
+// From now on keep queued messages back until releaseOutboundMessages is called
+void holdOutboundMessages() {
+    pthread_mutex_lock(&outboundQueue.mutex);
+    outboundQueue.holding = true;
+    outboundQueue.releasedTotal = outboundQueue.queuedTotal;
+    pthread_mutex_unlock(&outboundQueue.mutex);
+}
+
+// Let everything queued so far go out
+void releaseOutboundMessages() {
+    pthread_mutex_lock(&outboundQueue.mutex);
+    if (outboundQueue.holding) {
+        outboundQueue.releasedTotal = outboundQueue.queuedTotal;
+        pthread_cond_signal(&outboundQueue.notEmpty);
+    }
+    pthread_mutex_unlock(&outboundQueue.mutex);
+}
+
+// Wait until every released message is sent, then copy out the held ones in order.
+// Returns how many there are, or -1 if they do not fit in `capacity`.
+int copyHeldMessages(MessageStruct *out, int capacity) {
+    pthread_mutex_lock(&outboundQueue.mutex);
+    while (outboundQueue.sentTotal < outboundQueue.releasedTotal &&
+           outboundQueue.sentTotal < outboundQueue.queuedTotal) {
+        pthread_cond_wait(&outboundQueue.sent, &outboundQueue.mutex);
+    }
+    int held = outboundQueue.count;
+    if (held <= capacity) {
+        for (int i = 0; i < held; i++) {
+            out[i] = outboundQueue.messages[(outboundQueue.head + i) % outboundQueue.capacity];
+        }
+    }
+    pthread_mutex_unlock(&outboundQueue.mutex);
+    return held <= capacity ? held : -1;
+}
+
+// Block until every queued message has been handed to the kernel
+void flushOutboundQueue() {
+    releaseOutboundMessages();
+    waitOutboundSent(outboundQueuedTotal());
+}
+
+void stopOutboundSender() {
+    pthread_mutex_lock(&outboundQueue.mutex);
+    outboundQueue.stopping = true;
+    pthread_cond_signal(&outboundQueue.notEmpty);
+    pthread_mutex_unlock(&outboundQueue.mutex);
+
+    pthread_join(outboundQueue.senderThread, NULL);
+    free(outboundQueue.messages);
+}
+
+int compareDockIdsByCategory(const void *a, const void *b) {
+    const Dock *x = &docks[*(const int *)a];
+    const Dock *y = &docks[*(const int *)b];
+    if (x->category != y->category) {
+        return x->category - y->category;
+    }
+    return x->id - y->id;
+}
+
 void initializeIPC(char *filename) {
     FILE *file = fopen(filename, "r");
     if (file == NULL) {
@@ -149,6 +521,15 @@ void initializeIPC(char *filename) {
             exit(1);
         }
         
+        docks[i].craneUsedTimestep = (int *)calloc(docks[i].category, sizeof(int));
+        docks[i].plannedCargo = (int *)malloc(docks[i].category * sizeof(int));
+        docks[i].plannedCranes = (int *)malloc(docks[i].category * sizeof(int));
+        if (docks[i].craneUsedTimestep == NULL || docks[i].plannedCargo == NULL || docks[i].plannedCranes == NULL) {
+            perror("Memory allocation failed for crane bookkeeping");
+            exit(1);
+        }
+        docks[i].plannedCount = 0;
+        
         // Initialize max crane capacity to lowest possible value
         docks[i].maxCraneCapacity = 0;
         
@@ -163,17 +544,43 @@ void initializeIPC(char *filename) {
         
         docks[i].isOccupied = false;
         docks[i].allCargoMoved = false;
+        docks[i].authSearchState = AUTH_SEARCH_IDLE;
+        docks[i].ship = NULL;
+        docks[i].authResume = false;
     }
     fclose(file);
 
+    // Rank docks by category, then id, and mark them all free
+    dockWords = (numDocks + 63) / 64;
+    dockAtRank = (int *)malloc(numDocks * sizeof(int));
+    freeDockBits = (uint64_t *)calloc(dockWords, sizeof(uint64_t));
+    if (dockAtRank == NULL || freeDockBits == NULL) {
+        perror("Memory allocation failed for dock bitsets");
+        exit(1);
+    }
+    for (int i = 0; i < numDocks; i++) {
+        dockAtRank[i] = i;
+    }
+    qsort(dockAtRank, numDocks, sizeof(int), compareDockIdsByCategory);
+    for (int r = 0; r < numDocks; r++) {
+        docks[dockAtRank[r]].rank = r;
+        freeDockBits[r / 64] |= 1ULL << (r % 64);
+    }
+
+    initIdSet(&occupiedDocks, numDocks);
+    initIdSet(&completedDocks, numDocks);
+    initIdSet(&waitingShips, MAX_SHIP_REQUESTS);
+    initIdSet(&arrivedShips, MAX_SHIP_REQUESTS);
+
     
-    shmId = shmget(shmKey, sizeof(MainSharedMemory), 0666);
+    authStringSlots = numDocks > MAX_DOCKS ? numDocks : MAX_DOCKS;
+    shmId = shmget(shmKey, authStringSlots * 100 + MAX_NEW_REQUESTS * sizeof(ShipRequest), 0666);
     if (shmId == -1) {
         perror("Error connecting to shared memory");
         exit(1);
     }
 
-    sharedMemory = (MainSharedMemory *)shmat(shmId, NULL, 0);
+    sharedMemory = (char *)shmat(shmId, NULL, 0);
     if (sharedMemory == (void *)-1) {
         perror("Error attaching to shared memory");
         exit(1);
@@ -194,23 +601,131 @@ void initializeIPC(char *filename) {
     }
 }
 
+char *authStringSlot(int dockId) {
+    return sharedMemory + dockId * 100;
+}
+
+ShipRequest *sharedShipRequests() {
+    return (ShipRequest *)(sharedMemory + authStringSlots * 100);
+}
+
 void calculateShipProperties() {
-    // Calculate max cargo weight for each ship
-    for (int i = 0; i < shipCount; i++) {
-        if (!ships[i]->isServiced && ships[i]->maxCargoWeight == 0) {
-            ships[i]->maxCargoWeight = 0;
-            for (int j = 0; j < ships[i]->numCargo; j++) {
-                if (ships[i]->cargo[j] > ships[i]->maxCargoWeight) {
-                    ships[i]->maxCargoWeight = ships[i]->cargo[j];
+    // Calculate max cargo weight for ships that arrived this timestep
+    for (int k = 0; k < arrivedShips.count; k++) {
+        Ship *ship = ships[arrivedShips.ids[k]];
+        if (!ship->isServiced && ship->maxCargoWeight == 0) {
+            ship->maxCargoWeight = 0;
+            for (int j = 0; j < ship->numCargo; j++) {
+                if (ship->cargo[j] > ship->maxCargoWeight) {
+                    ship->maxCargoWeight = ship->cargo[j];
                 }
             }
         }
     }
 }
 
+// Weights used by prioritizeShips. The defaults are the original hand-picked values;
+// --policy <file> overrides any of them with "name value" lines.
+typedef struct SchedulerPolicy {
+    int emergencyPriority;
+    int overduePriority;      // incoming ship at or past its waiting deadline
+    int urgentPriority;       // deadline within urgentWindow timesteps
+    int soonPriority;         // deadline within soonWindow timesteps
+    int laterPriority;
+    int urgentWindow;
+    int soonWindow;
+    int largeCargoThreshold;  // cargo efficiency only counts above this many items
+    int cargoEfficiencyWeight;
+    int outgoingBasePriority;
+    int outgoingWaitWeight;
+    int cargoDensityWeight;
+    int lightCargoWeight;     // per unit of max cargo weight below 50
+    int arrivalWeight;        // per timestep of arrival earlier than 1000 timesteps ago
+} SchedulerPolicy;
+
+SchedulerPolicy policy = {
+    .emergencyPriority = 1000000,
+    .overduePriority = 500000,
+    .urgentPriority = 250000,
+    .soonPriority = 100000,
+    .laterPriority = 50000,
+    .urgentWindow = 3,
+    .soonWindow = 10,
+    .largeCargoThreshold = 20,
+    .cargoEfficiencyWeight = 10000,
+    .outgoingBasePriority = 10000,
+    .outgoingWaitWeight = 100,
+    .cargoDensityWeight = 5000,
+    .lightCargoWeight = 100,
+    .arrivalWeight = 10
+};
+
+typedef struct PolicyField {
+    const char *name;
+    int *value;
+} PolicyField;
+
+PolicyField policyFields[] = {
+    {"emergencyPriority", &policy.emergencyPriority},
+    {"overduePriority", &policy.overduePriority},
+    {"urgentPriority", &policy.urgentPriority},
+    {"soonPriority", &policy.soonPriority},
+    {"laterPriority", &policy.laterPriority},
+    {"urgentWindow", &policy.urgentWindow},
+    {"soonWindow", &policy.soonWindow},
+    {"largeCargoThreshold", &policy.largeCargoThreshold},
+    {"cargoEfficiencyWeight", &policy.cargoEfficiencyWeight},
+    {"outgoingBasePriority", &policy.outgoingBasePriority},
+    {"outgoingWaitWeight", &policy.outgoingWaitWeight},
+    {"cargoDensityWeight", &policy.cargoDensityWeight},
+    {"lightCargoWeight", &policy.lightCargoWeight},
+    {"arrivalWeight", &policy.arrivalWeight}
+};
+
+// Read a policy file: one "name value" pair per line, '#' starts a comment
+void loadPolicy(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror("Error opening policy file");
+        exit(1);
+    }
+
+    char line[256];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+        char *comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+
+        char name[64];
+        int value;
+        int fields = sscanf(line, "%63s %d", name, &value);
+        if (fields <= 0) {
+            continue;
+        }
+
+        bool known = false;
+        for (size_t i = 0; fields == 2 && i < sizeof(policyFields) / sizeof(policyFields[0]); i++) {
+            if (strcmp(policyFields[i].name, name) == 0) {
+                *policyFields[i].value = value;
+                known = true;
+                break;
+            }
+        }
+        if (!known) {
+            fprintf(stderr, "%s:%d: expected a policy weight name and an integer\n", path, lineNumber);
+            exit(1);
+        }
+    }
+    fclose(file);
+}
+
 void prioritizeShips() {
-    for (int i = 0; i < shipCount; i++) {
-        Ship *ship = ships[i];
+    // Only waiting ships are ranked; their priority depends on the current timestep
+    for (int k = 0; k < waitingShips.count; k++) {
+        Ship *ship = ships[waitingShips.ids[k]];
         
         if (ship->isServiced || ship->isAssignedDock) {
             continue;
@@ -220,7 +735,7 @@ void prioritizeShips() {
         
         // Emergency ships still get highest priority
         if (ship->direction == 1 && ship->emergency == 1) {
-            ship->priority += 1000000;
+            ship->priority += policy.emergencyPriority;
             continue;
         }
         
@@ -229,54 +744,86 @@ void prioritizeShips() {
             int timeRemaining = (ship->arrivalTimestep + ship->waitingTime) - currentTimestep;
             
             if (timeRemaining <= 0) {
-                ship->priority += 500000;
-            } else if (timeRemaining <= 3) {
-                ship->priority += 250000;
-            } else if (timeRemaining <= 10) {
-                ship->priority += 100000;
+                ship->priority += policy.overduePriority;
+            } else if (timeRemaining <= policy.urgentWindow) {
+                ship->priority += policy.urgentPriority;
+            } else if (timeRemaining <= policy.soonWindow) {
+                ship->priority += policy.soonPriority;
             } else {
-                ship->priority += 50000;
+                ship->priority += policy.laterPriority;
             }
             
-            if(ship->numCargo>20){
+            if(ship->numCargo>policy.largeCargoThreshold){
             // Add priority based on cargo efficiency (cargo count / waiting time)
             float cargoEfficiency = (float)ship->numCargo / ship->waitingTime;
-            ship->priority += (int)(cargoEfficiency * 10000);
+            ship->priority += (int)(cargoEfficiency * policy.cargoEfficiencyWeight);
             }
         }
         
         // Outgoing ships - prioritize based on how long they've been waiting
         if (ship->direction == -1) {
             int waitingTime = currentTimestep - ship->arrivalTimestep;
-            ship->priority += 10000 + (waitingTime * 100);
+            ship->priority += policy.outgoingBasePriority + (waitingTime * policy.outgoingWaitWeight);
         }
         
         // Prioritize ships with higher cargo density (more cargo items relative to category)
         float cargoDensity = (float)ship->numCargo / ship->category;
-        ship->priority += (int)(cargoDensity * 5000);
+        ship->priority += (int)(cargoDensity * policy.cargoDensityWeight);
         
         // Prioritize ships with lower max cargo weight (easier to process)
-        ship->priority += (50 - ship->maxCargoWeight) * 100;
+        ship->priority += (50 - ship->maxCargoWeight) * policy.lightCargoWeight;
         
         // Earlier arrival time gets higher priority
-        ship->priority += (1000 - (currentTimestep - ship->arrivalTimestep)) * 10;
+        ship->priority += (1000 - (currentTimestep - ship->arrivalTimestep)) * policy.arrivalWeight;
+    }
+}
+
+// Whether the dock can ever take this ship: category and crane capacity are fixed
+bool shipFitsDock(Ship *ship, Dock *dock) {
+    // Check category constraint
+    if (dock->category < ship->category) {
+        return false;
+    }
+    
+    // Check if any crane can handle the max cargo weight
+    if (dock->maxCraneCapacity < ship->maxCargoWeight) {
+        return false;
+    }
+    
+    // All checks passed
+    return true;
+}
+
+void computeDockCompatibility(Ship *ship) {
+    ship->compatibleDocks = (uint64_t *)calloc(dockWords, sizeof(uint64_t));
+    if (ship->compatibleDocks == NULL) {
+        perror("Memory allocation failed for ship dock bitset");
+        exit(1);
+    }
+    for (int r = 0; r < numDocks; r++) {
+        if (shipFitsDock(ship, &docks[dockAtRank[r]])) {
+            ship->compatibleDocks[r / 64] |= 1ULL << (r % 64);
+        }
     }
 }
 
 void processNewShipRequests(int numNewRequests) {
     for (int i = 0; i < numNewRequests; i++) {
-        ShipRequest newRequest = sharedMemory->newShipRequests[i];
+        ShipRequest newRequest = sharedShipRequests()[i];
         
         // Check if ship already exists (might have returned after waiting time)
         bool shipExists = false;
-        for (int j = 0; j < shipCount; j++) {
-            if (ships[j]->id == newRequest.shipId && ships[j]->direction == newRequest.direction) {
-                // Ship already exists, update its arrival timestep
-                ships[j]->arrivalTimestep = newRequest.timestep;
-                ships[j]->isAssignedDock = false;
-                shipExists = true;
-                break;
+        int slot = shipTableSlot(newRequest.shipId, newRequest.direction);
+        Ship *existing = shipTable[slot];
+        if (existing != NULL) {
+            // Ship already exists, update its arrival timestep
+            existing->arrivalTimestep = newRequest.timestep;
+            existing->isAssignedDock = false;
+            if (!existing->isServiced) {
+                addToIdSet(&waitingShips, existing->index);
             }
+            addToIdSet(&arrivedShips, existing->index);
+            shipExists = true;
         }
         
         if (!shipExists) {
@@ -317,197 +864,590 @@ void processNewShipRequests(int numNewRequests) {
                 }
             }
             
+            // Dock compatibility never changes for a ship, so work it out once on arrival
+            computeDockCompatibility(newShip);
+            
+            newShip->index = shipCount;
             ships[shipCount++] = newShip;
+            shipTable[slot] = newShip;
+            unservicedShipCount++;
+            addToIdSet(&waitingShips, newShip->index);
+            addToIdSet(&arrivedShips, newShip->index);
         }
     }
 }
 
 
 bool checkIfAllShipsServiced() {
-    for (int i = 0; i < shipCount; i++) {
-        if (!ships[i]->isServiced) {
-            return false;
-        }
+    return unservicedShipCount == 0;
+}
+
+// Auth strings use '5'-'9' everywhere and '.' only in the middle positions.
+// Candidates are numbered in lexicographic order with the last character varying fastest.
+const char authChars[] = "56789.";
+
+typedef struct CandidateTable {
+    int stringLength;
+    long long count;
+    int bytesPerCandidate;
+    unsigned char *packed; // 4 bits per character (index into authChars), candidates stored back to back
+} CandidateTable;
+
+// Cached candidate tables indexed by string length, shared by all guesser threads and docks
+CandidateTable *candidateTables[100];
+long long candidateTableBytes = 0;
+pthread_mutex_t candidateTableMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Every packed byte decoded to its two characters, so a candidate unpacks with 2-byte copies
+char packedPairs[256][2];
+
+void initCandidateDecoding() {
+    for (int b = 0; b < 256; b++) {
+        packedPairs[b][0] = authChars[(b & 0x0F) % 6];
+        packedPairs[b][1] = authChars[(b >> 4) % 6];
     }
-    return true;
 }
 
-void* authStringGuesser(void* arg) {
-    ThreadData* data = (ThreadData*)arg;
-    int dockId = data->dockId;
-    int solverIdx = data->solverIdx;
-    int threadId = data->threadId;
-    int numThreads = data->numThreads;
-    int stringLength = data->stringLength;
-    
-    
-    char possibleFirstLastChars[] = "56789"; 
-    char possibleMiddleChars[] = "56789.";  
-    
-    int firstLastCombinations = 5; 
+long long countCandidates(int stringLength) {
+    if (stringLength <= 1) {
+        return 5;
+    }
 
-    long long totalCombinations = firstLastCombinations * firstLastCombinations;
+    long long total = 25;
     for (int i = 0; i < stringLength - 2; i++) {
-        totalCombinations *= 6;
+        if (total > LLONG_MAX / 6) {
+            return LLONG_MAX; // Too many to enumerate anyway
+        }
+        total *= 6;
     }
-    
-    long long combinationsPerThread = totalCombinations / numThreads;
-    long long startCombo = threadId * combinationsPerThread;
-    long long endCombo = (threadId == numThreads - 1) ? 
-                         totalCombinations : (threadId + 1) * combinationsPerThread;
-    
-    //printf("Thread %d (solver %d) will try combinations %lld to %lld (of %lld total)\n", 
-           //threadId, solverIdx, startCombo, endCombo, totalCombinations);
-    
-    // Set dock ID for this solver
-    SolverRequest setDockRequest;
-    setDockRequest.mtype = 1;
-    setDockRequest.dockId = dockId;
-    
-    if (msgsnd(solverQueueIds[solverIdx], &setDockRequest, sizeof(SolverRequest) - sizeof(long), 0) == -1) {
-        perror("Error sending solver dock message");
-        data->success = false;
+    return total;
+}
+
+// Build the candidate string with the given index directly, without a table
+void decodeCandidate(int stringLength, long long index, char *authString) {
+    for (int pos = stringLength - 1; pos >= 0; pos--) {
+        int radix = (pos == 0 || pos == stringLength - 1) ? 5 : 6;
+        authString[pos] = authChars[index % radix];
+        index /= radix;
+    }
+    authString[stringLength] = '\0';
+}
+
+// Returns the shared table for this length, building it on first use.
+// Returns NULL if the table would push the cache past AUTH_TABLE_MEMORY_LIMIT.
+CandidateTable *getCandidateTable(int stringLength) {
+    pthread_mutex_lock(&candidateTableMutex);
+
+    CandidateTable *table = candidateTables[stringLength];
+    if (table != NULL) {
+        pthread_mutex_unlock(&candidateTableMutex);
+        return table;
+    }
+
+    long long count = countCandidates(stringLength);
+    int bytesPerCandidate = (stringLength + 1) / 2;
+    if (count > (AUTH_TABLE_MEMORY_LIMIT - candidateTableBytes) / bytesPerCandidate) {
+        pthread_mutex_unlock(&candidateTableMutex);
         return NULL;
     }
-    
-    
-    char authString[100];
-    memset(authString, 0, 100);
-    
-    // Set first and last characters (not '.')
-    authString[0] = possibleFirstLastChars[0];
-    if (stringLength > 1) {
-        authString[stringLength - 1] = possibleFirstLastChars[0];
-    }
-    
-    // Set middle characters
-    for (int i = 1; i < stringLength - 1; i++) {
-        authString[i] = possibleMiddleChars[0];
-    }
-    
-    //skip to starting combination
-    long long currentCombo = 0;
-    while (currentCombo < startCombo) {
-        // Generate next combination
-        int pos = stringLength - 1;
-        while (pos >= 0) {
-            if (pos == 0 || pos == stringLength - 1) {
-                // first or last character
-                int idx = -1;
-                for (int i = 0; i < 5; i++) {
-                    if (authString[pos] == possibleFirstLastChars[i]) {
-                        idx = i;
-                        break;
-                    }
-                }
-                
-                if (idx == 4) { //last possible character
-                    authString[pos] = possibleFirstLastChars[0];
-                    pos--;
-                } else {
-                    authString[pos] = possibleFirstLastChars[idx + 1];
-                    break;
-                }
-            } else {
-                // middle characters
-                int idx = -1;
-                for (int i = 0; i < 6; i++) {
-                    if (authString[pos] == possibleMiddleChars[i]) {
-                        idx = i;
-                        break;
-                    }
-                }
-                
-                if (idx == 5) { // Last possible character
-                    authString[pos] = possibleMiddleChars[0];
-                    pos--;
-                } else {
-                    authString[pos] = possibleMiddleChars[idx + 1];
-                    break;
-                }
-            }
-        }
-        
-        currentCombo++;
+
+    table = (CandidateTable *)malloc(sizeof(CandidateTable));
+    unsigned char *packed = (unsigned char *)calloc(count, bytesPerCandidate);
+    if (table == NULL || packed == NULL) {
+        free(table);
+        free(packed);
+        pthread_mutex_unlock(&candidateTableMutex);
+        return NULL;
     }
-    
-    // Now try combinations from startCombo to endCombo
-    while (currentCombo < endCombo) {
-        // Check if another thread found the solution
-        if (authStringFound) {
-            data->success = false;
-            return NULL;
-        }
-        
-        // Send the guess
-        SolverRequest guessRequest;
-        guessRequest.mtype = 2;
-        strncpy(guessRequest.authStringGuess, authString, 100);
-        
-        if (msgsnd(solverQueueIds[solverIdx], &guessRequest, sizeof(SolverRequest) - sizeof(long), 0) == -1) {
-            perror("Error sending solver guess message");
-            continue;
+
+    // Walk all candidates in order with an odometer over character indices
+    int digits[100] = {0};
+    for (long long c = 0; c < count; c++) {
+        unsigned char *entry = packed + c * bytesPerCandidate;
+        for (int pos = 0; pos < stringLength; pos++) {
+            entry[pos / 2] |= digits[pos] << ((pos % 2) * 4);
         }
-        
-        // Wait for the response
-        SolverResponse response;
-        if (msgrcv(solverQueueIds[solverIdx], &response, sizeof(SolverResponse) - sizeof(long), 3, 0) == -1) {
-            perror("Error receiving solver response");
-            continue;
+
+        for (int pos = stringLength - 1; pos >= 0; pos--) {
+            int radix = (pos == 0 || pos == stringLength - 1) ? 5 : 6;
+            if (++digits[pos] < radix) {
+                break;
+            }
+            digits[pos] = 0;
         }
-        
-        // Check if the guess is correct
-        if (response.guessIsCorrect == 1) {
-            // Correct guess, set the result and notify other threads
-            pthread_mutex_lock(&authMutex);
-            authStringFound = true;
-            strncpy(data->authString, authString, 100);
+    }
+
+    table->stringLength = stringLength;
+    table->count = count;
+    table->bytesPerCandidate = bytesPerCandidate;
+    table->packed = packed;
+
+    candidateTables[stringLength] = table;
+    candidateTableBytes += count * bytesPerCandidate;
+
+    pthread_mutex_unlock(&candidateTableMutex);
+    return table;
+}
+
+// Write candidate number index into authString, from the table if there is one
+void loadCandidate(CandidateTable *table, int stringLength, long long index, char *authString) {
+    if (table == NULL) {
+        decodeCandidate(stringLength, index, authString);
+        return;
+    }
+
+    const unsigned char *entry = table->packed + index * table->bytesPerCandidate;
+    for (int i = 0; i < table->bytesPerCandidate; i++) {
+        memcpy(authString + 2 * i, packedPairs[entry[i]], 2);
+    }
+    authString[stringLength] = '\0';
+}
+
+// Auth strings found so far, used to order candidates in GUESS_ORDER_HISTORY mode
+typedef struct AuthHistoryEntry {
+    char authString[100];
+    int count;
+} AuthHistoryEntry;
+
+typedef struct AuthHistory {
+    AuthHistoryEntry *entries[100]; // distinct strings per length, most frequent first
+    int entryCount[100];
+    int entryCapacity[100];
+    int charCounts[100][100][6];    // [length][position][index into authChars]
+    int classCounts[3][6];          // first / middle / last positions over all lengths
+    long long searches;
+    long long guessesSent;          // solver requests across all threads
+    long long orderedGuesses;       // position of the answer in the order used
+    long long lexicographicGuesses; // position of the answer in lexicographic order
+} AuthHistory;
+
+AuthHistory authHistory;
+int guessOrder = GUESS_ORDER_LEXICOGRAPHIC;
+
+// Everything a guesser thread needs to walk one search, fixed when the search starts
+typedef struct GuessPlan {
+    int stringLength;
+    int order;
+    CandidateTable *table;    // lexicographic order only, NULL to decode on the fly
+    char rankedChars[100][6]; // history order: characters per position, most likely first
+    char (*previous)[100];    // history order: earlier auth strings of this length, tried first
+    long long *previousIndices; // history order: their ranked indices, ascending
+    int previousCount;
+    long long total;          // previousCount + size of the candidate space
+} GuessPlan;
+
+int positionClass(int stringLength, int pos) {
+    if (pos == 0) return 0;
+    if (pos == stringLength - 1) return 2;
+    return 1;
+}
+
+int positionRadix(int stringLength, int pos) {
+    return (pos == 0 || pos == stringLength - 1) ? 5 : 6;
+}
+
+void recordAuthString(const char *authString) {
+    int stringLength = strlen(authString);
+
+    for (int pos = 0; pos < stringLength; pos++) {
+        int c = strchr(authChars, authString[pos]) - authChars;
+        authHistory.charCounts[stringLength][pos][c]++;
+        authHistory.classCounts[positionClass(stringLength, pos)][c]++;
+    }
+
+    AuthHistoryEntry *entries = authHistory.entries[stringLength];
+    int count = authHistory.entryCount[stringLength];
+    int i;
+    for (i = 0; i < count; i++) {
+        if (strcmp(entries[i].authString, authString) == 0) {
+            break;
+        }
+    }
+
+    if (i == count) {
+        if (count == authHistory.entryCapacity[stringLength]) {
+            int newCapacity = count == 0 ? 8 : count * 2;
+            entries = (AuthHistoryEntry *)realloc(entries, newCapacity * sizeof(AuthHistoryEntry));
+            if (entries == NULL) {
+                perror("Memory allocation failed for auth history");
+                exit(1);
+            }
+            authHistory.entries[stringLength] = entries;
+            authHistory.entryCapacity[stringLength] = newCapacity;
+        }
+        snprintf(entries[i].authString, sizeof(entries[i].authString), "%s", authString);
+        entries[i].count = 0;
+        authHistory.entryCount[stringLength]++;
+    }
+    entries[i].count++;
+
+    // Keep most frequent first
+    while (i > 0 && entries[i - 1].count < entries[i].count) {
+        AuthHistoryEntry temp = entries[i - 1];
+        entries[i - 1] = entries[i];
+        entries[i] = temp;
+        i--;
+    }
+}
+
+// Index of authString in the history-ranked enumeration
+long long rankedIndexOf(GuessPlan *plan, const char *authString) {
+    long long index = 0;
+    for (int pos = 0; pos < plan->stringLength; pos++) {
+        int radix = positionRadix(plan->stringLength, pos);
+        int digit = 0;
+        while (plan->rankedChars[pos][digit] != authString[pos]) {
+            digit++;
+        }
+        index = index * radix + digit;
+    }
+    return index;
+}
+
+int compareIndices(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+void buildGuessPlan(GuessPlan *plan, int stringLength) {
+    plan->stringLength = stringLength;
+    plan->order = guessOrder;
+    plan->table = NULL;
+    plan->previous = NULL;
+    plan->previousIndices = NULL;
+    plan->previousCount = 0;
+
+    long long candidates = countCandidates(stringLength);
+
+    if (plan->order == GUESS_ORDER_LEXICOGRAPHIC) {
+        plan->table = getCandidateTable(stringLength);
+        plan->total = candidates;
+        return;
+    }
+
+    // Rank characters per position by how often they appeared there; the
+    // length-specific counts dominate, the position-class counts break ties
+    for (int pos = 0; pos < stringLength; pos++) {
+        int radix = positionRadix(stringLength, pos);
+        int class = positionClass(stringLength, pos);
+        int score[6];
+        for (int c = 0; c < radix; c++) {
+            score[c] = authHistory.charCounts[stringLength][pos][c] * 4 + authHistory.classCounts[class][c];
+            plan->rankedChars[pos][c] = authChars[c];
+        }
+        for (int i = 0; i < radix - 1; i++) {
+            for (int j = 0; j < radix - i - 1; j++) {
+                if (score[j] < score[j + 1]) {
+                    int tempScore = score[j];
+                    score[j] = score[j + 1];
+                    score[j + 1] = tempScore;
+                    char tempChar = plan->rankedChars[pos][j];
+                    plan->rankedChars[pos][j] = plan->rankedChars[pos][j + 1];
+                    plan->rankedChars[pos][j + 1] = tempChar;
+                }
+            }
+        }
+    }
+
+    int previousCount = authHistory.entryCount[stringLength];
+    if (previousCount > 0) {
+        plan->previous = malloc(previousCount * sizeof(*plan->previous));
+        plan->previousIndices = (long long *)malloc(previousCount * sizeof(long long));
+        if (plan->previous == NULL || plan->previousIndices == NULL) {
+            perror("Memory allocation failed for guess plan");
+            exit(1);
+        }
+        plan->previousCount = previousCount;
+        for (int i = 0; i < previousCount; i++) {
+            strncpy(plan->previous[i], authHistory.entries[stringLength][i].authString, 100);
+            plan->previousIndices[i] = rankedIndexOf(plan, plan->previous[i]);
+        }
+        // The enumeration skips these, so it looks them up by index instead of comparing strings
+        qsort(plan->previousIndices, previousCount, sizeof(long long), compareIndices);
+    }
+
+    plan->total = (candidates > LLONG_MAX - previousCount) ? LLONG_MAX : candidates + previousCount;
+}
+
+void freeGuessPlan(GuessPlan *plan) {
+    free(plan->previous);
+    free(plan->previousIndices);
+    plan->previous = NULL;
+    plan->previousIndices = NULL;
+}
+
+long long lexicographicIndexOf(const char *authString) {
+    int stringLength = strlen(authString);
+    long long index = 0;
+    for (int pos = 0; pos < stringLength; pos++) {
+        index = index * positionRadix(stringLength, pos) + (strchr(authChars, authString[pos]) - authChars);
+    }
+    return index;
+}
+
+// Write the candidate at position seq of the plan's order into authString.
+// Returns false if that candidate was already tried from the history list.
+bool planCandidate(GuessPlan *plan, long long seq, char *authString) {
+    if (seq < plan->previousCount) {
+        strncpy(authString, plan->previous[seq], 100);
+        return true;
+    }
+
+    long long index = seq - plan->previousCount;
+    if (plan->order == GUESS_ORDER_LEXICOGRAPHIC) {
+        loadCandidate(plan->table, plan->stringLength, index, authString);
+        return true;
+    }
+
+    if (plan->previousCount > 0 &&
+        bsearch(&index, plan->previousIndices, plan->previousCount, sizeof(long long), compareIndices) != NULL) {
+        return false;
+    }
+
+    for (int pos = plan->stringLength - 1; pos >= 0; pos--) {
+        int radix = positionRadix(plan->stringLength, pos);
+        authString[pos] = plan->rankedChars[pos][index % radix];
+        index /= radix;
+    }
+    authString[plan->stringLength] = '\0';
+    return true;
+}
+
+// Book-keeping after a successful search: how many guesses the order used took
+// and how many plain lexicographic order would have taken
+void recordSearchStats(GuessPlan *plan, long long foundSeq, long long guessesSent, const char *authString) {
+    long long ordered = foundSeq + 1;
+    if (foundSeq >= plan->previousCount) {
+        // History strings were skipped in the enumeration, so they cost nothing twice
+        for (int i = 0; i < plan->previousCount && plan->previousCount + plan->previousIndices[i] < foundSeq; i++) {
+            ordered--;
+        }
+    }
+
+    authHistory.searches++;
+    authHistory.guessesSent += guessesSent;
+    authHistory.orderedGuesses += ordered;
+    authHistory.lexicographicGuesses += lexicographicIndexOf(authString) + 1;
+}
+
+void printAuthSearchStats() {
+    if (authHistory.searches == 0) {
+        return;
+    }
+    double searches = (double)authHistory.searches;
+    printf("Auth search (%s order): %lld undocks, %.1f solver requests per undock, "
+           "%.1f guesses to answer vs %.1f in lexicographic order\n",
+           guessOrder == GUESS_ORDER_HISTORY ? "history" : "lexicographic",
+           authHistory.searches, authHistory.guessesSent / searches,
+           authHistory.orderedGuesses / searches, authHistory.lexicographicGuesses / searches);
+}
+
+// Offer the batched protocol to every solver with an empty probe. Solvers that do not
+// answer in time get their probe taken back and keep the one-guess protocol.
+void negotiateBatchGuesses() {
+    BatchSolverRequest probe;
+    probe.mtype = SOLVER_BATCH_REQUEST;
+    probe.dockId = -1;
+    probe.stringLength = 0;
+    probe.count = 0;
+
+    for (int i = 0; i < numSolvers; i++) {
+        solverTakesBatches[i] = false;
+        if (msgsnd(solverQueueIds[i], &probe, BATCH_REQUEST_SIZE(0, 0), 0) == -1) {
+            perror("Error sending solver batch probe");
+            exit(1);
+        }
+    }
+
+    int answered = 0;
+    for (int waited = 0; waited < SOLVER_PROBE_TIMEOUT_MS && answered < numSolvers; waited++) {
+        for (int i = 0; i < numSolvers; i++) {
+            BatchSolverResponse response;
+            if (!solverTakesBatches[i] &&
+                msgrcv(solverQueueIds[i], &response, sizeof(BatchSolverResponse) - sizeof(long),
+                       SOLVER_BATCH_RESPONSE, IPC_NOWAIT) != -1) {
+                solverTakesBatches[i] = true;
+                answered++;
+            }
+        }
+        if (answered < numSolvers) {
+            usleep(1000);
+        }
+    }
+
+    for (int i = 0; i < numSolvers; i++) {
+        if (!solverTakesBatches[i]) {
+            msgrcv(solverQueueIds[i], &probe, sizeof(BatchSolverRequest) - sizeof(long),
+                   SOLVER_BATCH_REQUEST, IPC_NOWAIT);
+        }
+    }
+    printf("Batched guess verification: %d of %d solvers\n", answered, numSolvers);
+}
+
+// Batched counterpart of the guess loop in authStringGuesser: one request checks as
+// many candidates as fit in a message
+void guessInBatches(ThreadData *data, long long startCombo, long long endCombo, long long step) {
+    GuessPlan *plan = data->plan;
+    int length = data->stringLength;
+    int perBatch = BATCH_GUESS_BYTES / length;
+    long long batchCombos[BATCH_GUESS_BYTES];
+    BatchSolverRequest request;
+    request.mtype = SOLVER_BATCH_REQUEST;
+    request.dockId = data->dockId;
+    request.stringLength = length;
+
+    long long currentCombo = startCombo;
+    while (currentCombo < endCombo) {
+        if (authStringFound) {
+            break;
+        }
+
+        __atomic_store_n(&docks[data->dockId].authCursor[data->threadId], currentCombo, __ATOMIC_RELAXED);
+
+        // Fill the batch
+        char candidate[100];
+        request.count = 0;
+        while (request.count < perBatch && currentCombo < endCombo) {
+            if (planCandidate(plan, currentCombo, candidate)) {
+                memcpy(request.guesses + request.count * length, candidate, length);
+                batchCombos[request.count++] = currentCombo;
+            }
+            if (currentCombo > LLONG_MAX - step) {
+                currentCombo = endCombo;
+                break;
+            }
+            currentCombo += step;
+        }
+        if (request.count == 0) {
+            break;
+        }
+
+        if (msgsnd(solverQueueIds[data->solverIdx], &request, BATCH_REQUEST_SIZE(request.count, length), 0) == -1) {
+            perror("Error sending solver batch message");
+            break;
+        }
+        data->guessesSent++;
+
+        BatchSolverResponse response;
+        if (msgrcv(solverQueueIds[data->solverIdx], &response, sizeof(BatchSolverResponse) - sizeof(long),
+                   SOLVER_BATCH_RESPONSE, 0) == -1) {
+            perror("Error receiving solver batch response");
+            break;
+        }
+
+        if (response.matchIndex >= 0 && response.matchIndex < request.count) {
+            pthread_mutex_lock(&authMutex);
+            authStringFound = true;
+            memcpy(data->authString, request.guesses + response.matchIndex * length, length);
+            data->authString[length] = '\0';
+            data->foundSeq = batchCombos[response.matchIndex];
             data->success = true;
             pthread_mutex_unlock(&authMutex);
+            return;
+        }
+    }
+
+    data->success = false;
+}
+
+void* authStringGuesser(void* arg) {
+    ThreadData* data = (ThreadData*)arg;
+    int dockId = data->dockId;
+    int solverIdx = data->solverIdx;
+    int threadId = data->threadId;
+    int numThreads = data->numThreads;
+    GuessPlan *plan = data->plan;
+    
+    long long totalCombinations = plan->total;
+    
+    // Lexicographic order splits the space into contiguous ranges. History order
+    // interleaves the threads so they all start on the most likely candidates.
+    long long startCombo, endCombo, step;
+    if (plan->order == GUESS_ORDER_HISTORY) {
+        startCombo = threadId;
+        endCombo = totalCombinations;
+        step = numThreads;
+    } else {
+        long long combinationsPerThread = totalCombinations / numThreads;
+        startCombo = threadId * combinationsPerThread;
+        endCombo = (threadId == numThreads - 1) ? 
+                   totalCombinations : (threadId + 1) * combinationsPerThread;
+        step = 1;
+        
+        // Candidates before a checkpointed cursor were already rejected
+        if (data->resumeFrom > startCombo && data->resumeFrom <= endCombo) {
+            startCombo = data->resumeFrom;
+        }
+    }
+    
+    //printf("Thread %d (solver %d) will try combinations %lld to %lld (of %lld total)\n", 
+           //threadId, solverIdx, startCombo, endCombo, totalCombinations);
+    
+    // Batches name their dock, so no set-dock message is needed
+    if (solverTakesBatches[solverIdx]) {
+        guessInBatches(data, startCombo, endCombo, step);
+        return NULL;
+    }
+    
+    // Set dock ID for this solver
+    SolverRequest setDockRequest;
+    setDockRequest.mtype = 1;
+    setDockRequest.dockId = dockId;
+    
+    if (msgsnd(solverQueueIds[solverIdx], &setDockRequest, sizeof(SolverRequest) - sizeof(long), 0) == -1) {
+        perror("Error sending solver dock message");
+        data->success = false;
+        return NULL;
+    }
+    
+    // Try combinations from startCombo to endCombo
+    long long currentCombo = startCombo;
+    while (currentCombo < endCombo) {
+        // Check if another thread found the solution
+        if (authStringFound) {
+            data->success = false;
             return NULL;
         }
         
-        // Generate next combination
-        int pos = stringLength - 1;
-        while (pos >= 0) {
-            if (pos == 0 || pos == stringLength - 1) {
-                // First or last character
-                int idx = -1;
-                for (int i = 0; i < 5; i++) {
-                    if (authString[pos] == possibleFirstLastChars[i]) {
-                        idx = i;
-                        break;
-                    }
-                }
-                
-                if (idx == 4) { // Last possible character
-                    authString[pos] = possibleFirstLastChars[0];
-                    pos--;
-                } else {
-                    authString[pos] = possibleFirstLastChars[idx + 1];
-                    break;
-                }
-            } else {
-                // Middle character
-                int idx = -1;
-                for (int i = 0; i < 6; i++) {
-                    if (authString[pos] == possibleMiddleChars[i]) {
-                        idx = i;
-                        break;
-                    }
-                }
-                
-                if (idx == 5) { // Last possible character
-                    authString[pos] = possibleMiddleChars[0];
-                    pos--;
-                } else {
-                    authString[pos] = possibleMiddleChars[idx + 1];
-                    break;
-                }
-            }
+        __atomic_store_n(&docks[dockId].authCursor[threadId], currentCombo, __ATOMIC_RELAXED);
+        
+        // Send the guess
+        SolverRequest guessRequest;
+        guessRequest.mtype = 2;
+        if (!planCandidate(plan, currentCombo, guessRequest.authStringGuess)) {
+            currentCombo += step;
+            continue;
+        }
+        
+        if (msgsnd(solverQueueIds[solverIdx], &guessRequest, sizeof(SolverRequest) - sizeof(long), 0) == -1) {
+            perror("Error sending solver guess message");
+            continue;
+        }
+        data->guessesSent++;
+        
+        // Wait for the response
+        SolverResponse response;
+        if (msgrcv(solverQueueIds[solverIdx], &response, sizeof(SolverResponse) - sizeof(long), 3, 0) == -1) {
+            perror("Error receiving solver response");
+            continue;
         }
         
-        currentCombo++;
+        // Check if the guess is correct
+        if (response.guessIsCorrect == 1) {
+            // Correct guess, set the result and notify other threads
+            pthread_mutex_lock(&authMutex);
+            authStringFound = true;
+            strncpy(data->authString, guessRequest.authStringGuess, 100);
+            data->foundSeq = currentCombo;
+            data->success = true;
+            pthread_mutex_unlock(&authMutex);
+            return NULL;
+        }
+        
+        if (currentCombo > LLONG_MAX - step) {
+            break;
+        }
+        currentCombo += step;
     }
     
     data->success = false;
@@ -516,24 +1456,23 @@ void* authStringGuesser(void* arg) {
 
 void loadAuthString(int dockId, char *authString) {
     // Copy the auth string to the shared memory for the specified dock
-    strncpy(sharedMemory->authStrings[dockId], authString, 100);
+    strncpy(authStringSlot(dockId), authString, 100);
     
     // Ensure null termination
-    sharedMemory->authStrings[dockId][100 - 1] = '\0';
+    authStringSlot(dockId)[100 - 1] = '\0';
 }
 
-bool guessAuthString(int dockId) {
-    // Determine string length (last cargo moved timestep - docking timestep)
-    Dock *dock = &docks[dockId];
-    int stringLength = dock->lastCargoMovedTimestep - dock->dockingTimestep;
-    
-    // Ensure a minimum length of 1
-    if (stringLength <= 0) stringLength = 1;
-    
+// Runs one search over all solvers. Only the auth worker thread calls this, so
+// searches never share a solver queue.
+bool solveAuthString(int dockId, int stringLength, const long long *resumeCursors, char *foundAuthString) {
     // Initialize mutex for thread synchronization
     pthread_mutex_init(&authMutex, NULL);
     authStringFound = false;
     
+    // Fix the candidate order for this search
+    GuessPlan plan;
+    buildGuessPlan(&plan, stringLength);
+    
     // Create threads, one for each solver
     pthread_t threads[8];
     ThreadData threadData[8];
@@ -548,7 +1487,12 @@ bool guessAuthString(int dockId) {
         threadData[i].threadId = i;
         threadData[i].numThreads = numSolvers;
         threadData[i].stringLength = stringLength;
+        threadData[i].plan = &plan;
         threadData[i].success = false;
+        threadData[i].foundSeq = -1;
+        threadData[i].guessesSent = 0;
+        threadData[i].resumeFrom = (resumeCursors != NULL && plan.order == GUESS_ORDER_LEXICOGRAPHIC) ? 
+                                   resumeCursors[i] : -1;
         
         if (pthread_create(&threads[i], NULL, authStringGuesser, &threadData[i]) != 0) {
             perror("Failed to create thread");
@@ -558,32 +1502,208 @@ bool guessAuthString(int dockId) {
     
     // Wait for all threads to complete
     bool success = false;
-    char foundAuthString[100];
+    long long foundSeq = -1;
+    long long guessesSent = 0;
     
     for (int i = 0; i < numSolvers; i++) {
         pthread_join(threads[i], NULL);
+        guessesSent += threadData[i].guessesSent;
         
         // Check if this thread found the solution
         if (threadData[i].success) {
             success = true;
             strncpy(foundAuthString, threadData[i].authString, 100);
+            foundSeq = threadData[i].foundSeq;
         }
     }
     
     // Clean up mutex
     pthread_mutex_destroy(&authMutex);
     
-    // If a solution was found, load it into shared memory
     if (success) {
         //printf("Auth string found: %s\n", foundAuthString);
-        loadAuthString(dockId, foundAuthString);
+        recordSearchStats(&plan, foundSeq, guessesSent, foundAuthString);
+        recordAuthString(foundAuthString);
+        freeGuessPlan(&plan);
         return true;
     }
     
+    freeGuessPlan(&plan);
+    
     //printf("Failed to find auth string for dock %d\n", dockId);
     return false;
 }
 
+// Searches are queued here as soon as a dock's length is known and solved one
+// at a time by the auth worker, overlapping with the main loop
+typedef struct AuthWorker {
+    int *pendingDocks; // FIFO of dock ids, at most one entry per dock
+    int head;
+    int count;
+    bool stopping;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t hasWork;
+    pthread_cond_t searchFinished;
+} AuthWorker;
+
+AuthWorker authWorker = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .hasWork = PTHREAD_COND_INITIALIZER,
+    .searchFinished = PTHREAD_COND_INITIALIZER
+};
+
+void* authWorkerLoop(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&authWorker.mutex);
+    while (true) {
+        while (authWorker.count == 0 && !authWorker.stopping) {
+            pthread_cond_wait(&authWorker.hasWork, &authWorker.mutex);
+        }
+        if (authWorker.count == 0) {
+            break;
+        }
+
+        Dock *dock = &docks[authWorker.pendingDocks[authWorker.head]];
+        authWorker.head = (authWorker.head + 1) % numDocks;
+        authWorker.count--;
+        int stringLength = dock->authStringLength;
+        long long afterMessage = dock->authSearchAfterMessage;
+        long long resumeCursors[8];
+        bool resume = dock->authResume;
+        if (resume) {
+            memcpy(resumeCursors, dock->authCursor, sizeof(resumeCursors));
+            dock->authResume = false;
+        }
+        pthread_mutex_unlock(&authWorker.mutex);
+
+        // The cargo moves that fixed this string must reach validation first
+        waitOutboundSent(afterMessage);
+
+        char foundAuthString[100];
+        bool success = solveAuthString(dock->id, stringLength, resume ? resumeCursors : NULL, foundAuthString);
+
+        pthread_mutex_lock(&authWorker.mutex);
+        if (success) {
+            strncpy(dock->foundAuthString, foundAuthString, 100);
+            dock->authSearchState = AUTH_SEARCH_DONE;
+        } else {
+            dock->authSearchState = AUTH_SEARCH_FAILED;
+        }
+        pthread_cond_broadcast(&authWorker.searchFinished);
+    }
+    pthread_mutex_unlock(&authWorker.mutex);
+    return NULL;
+}
+
+void startAuthWorker() {
+    authWorker.pendingDocks = (int *)malloc(numDocks * sizeof(int));
+    if (authWorker.pendingDocks == NULL) {
+        perror("Memory allocation failed for auth worker");
+        exit(1);
+    }
+    authWorker.head = 0;
+    authWorker.count = 0;
+    authWorker.stopping = false;
+
+    if (pthread_create(&authWorker.thread, NULL, authWorkerLoop, NULL) != 0) {
+        perror("Failed to create auth worker thread");
+        exit(1);
+    }
+}
+
+void stopAuthWorker() {
+    pthread_mutex_lock(&authWorker.mutex);
+    authWorker.stopping = true;
+    pthread_cond_signal(&authWorker.hasWork);
+    pthread_mutex_unlock(&authWorker.mutex);
+
+    pthread_join(authWorker.thread, NULL);
+    free(authWorker.pendingDocks);
+}
+
+// Caller holds authWorker.mutex
+void queueAuthSearchLocked(Dock *dock) {
+    // Determine string length (last cargo moved timestep - docking timestep)
+    int stringLength = dock->lastCargoMovedTimestep - dock->dockingTimestep;
+    
+    // Ensure a minimum length of 1
+    if (stringLength <= 0) stringLength = 1;
+
+    dock->authStringLength = stringLength;
+    // Wait only on released messages: one held back for a checkpoint goes out after the
+    // undock loop, so a search waiting on it would never start. The dock's cargo moves
+    // were released before it was ready to undock.
+    dock->authSearchAfterMessage = outboundReleasedTotal();
+    dock->authSearchState = AUTH_SEARCH_PENDING;
+    if (!dock->authResume) {
+        for (int i = 0; i < 8; i++) {
+            dock->authCursor[i] = -1;
+        }
+    }
+
+    authWorker.pendingDocks[(authWorker.head + authWorker.count) % numDocks] = dock->id;
+    authWorker.count++;
+    pthread_cond_signal(&authWorker.hasWork);
+}
+
+// Start solving a dock's auth string in the background once its last cargo has moved.
+// While messages are held for a checkpoint that move has not reached validation, so
+// the search waits for startCompletedAuthSearches after the release.
+void startAuthSearch(Dock *dock) {
+    if (outboundQueue.holding) {
+        return;
+    }
+    pthread_mutex_lock(&authWorker.mutex);
+    if (dock->authSearchState == AUTH_SEARCH_IDLE) {
+        queueAuthSearchLocked(dock);
+    }
+    pthread_mutex_unlock(&authWorker.mutex);
+}
+
+// Start the searches held back by startAuthSearch, once their messages are released
+void startCompletedAuthSearches() {
+    pthread_mutex_lock(&authWorker.mutex);
+    for (int i = 0; i < completedDocks.count; i++) {
+        Dock *dock = &docks[completedDocks.ids[i]];
+        if (dock->authSearchState == AUTH_SEARCH_IDLE) {
+            queueAuthSearchLocked(dock);
+        }
+    }
+    pthread_mutex_unlock(&authWorker.mutex);
+}
+
+// Collect the dock's auth string, waiting for its search if it is still running,
+// and load it into shared memory
+bool guessAuthString(int dockId) {
+    Dock *dock = &docks[dockId];
+    
+    pthread_mutex_lock(&authWorker.mutex);
+    
+    // A speculative search can miss if it ran before validation fixed the string; retry once
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (dock->authSearchState == AUTH_SEARCH_IDLE || dock->authSearchState == AUTH_SEARCH_FAILED) {
+            queueAuthSearchLocked(dock);
+        }
+        while (dock->authSearchState == AUTH_SEARCH_PENDING) {
+            pthread_cond_wait(&authWorker.searchFinished, &authWorker.mutex);
+        }
+        if (dock->authSearchState == AUTH_SEARCH_DONE) {
+            break;
+        }
+    }
+    
+    bool success = dock->authSearchState == AUTH_SEARCH_DONE;
+    dock->authSearchState = AUTH_SEARCH_IDLE;
+    pthread_mutex_unlock(&authWorker.mutex);
+    
+    // If a solution was found, load it into shared memory
+    if (success) {
+        loadAuthString(dockId, dock->foundAuthString);
+    }
+    return success;
+}
+
 bool undockShip(Dock *dock) {
     // Guess auth string
     if (!guessAuthString(dock->id)) {
@@ -597,14 +1717,15 @@ bool undockShip(Dock *dock) {
     message.direction = dock->occupiedByDirection;
     message.dockId = dock->id;
     
-    if (msgsnd(mainQueueId, &message, sizeof(MessageStruct) - sizeof(long), 0) == -1) {
-        perror("Error sending undock message");
-        exit(1);
-    }
+    queueMainMessage(&message);
     
     // Reset dock status
     dock->isOccupied = false;
     dock->allCargoMoved = false;
+    dock->ship = NULL;
+    freeDockBits[dock->rank / 64] |= 1ULL << (dock->rank % 64);
+    removeFromIdSet(&occupiedDocks, dock->id);
+    removeFromIdSet(&completedDocks, dock->id);
     
     return true;
 }
@@ -616,77 +1737,488 @@ bool attemptUndocking() {
     bool undockingFailed = false;
     
     // Try to undock ships that have finished cargo operations
+    int dockIds[completedDocks.count + 1];
+    int dockCount = sortedIdSet(&completedDocks, dockIds);
+    for (int k = 0; k < dockCount; k++) {
+        int i = dockIds[k];
+        
+        // Print dock status
+        //printf("Dock %d status: occupied by ship %d, allCargoMoved=%d, lastCargoMoved=%d\n", 
+               //i, docks[i].occupiedByShipId, docks[i].allCargoMoved, docks[i].lastCargoMovedTimestep);
+        
+        // Try to undock if it's not the same timestep as the last cargo movement
+        if (docks[i].lastCargoMovedTimestep < currentTimestep) {
+            // Find the ship at this dock
+            Ship *ship = shipAtDock(&docks[i]);
+            
+            if (ship == NULL) {
+                printf("Warning: No ship found at dock %d for undocking\n", i);
+                continue;
+            }
+            
+            //printf("Attempting to undock ship %d from dock %d\n", ship->id, i);
+            
+            // Double-check that all cargo has been moved
+            bool allMoved = true;
+            for (int j = 0; j < ship->numCargo; j++) {
+                if (!ship->cargoMoved[j]) {
+                    allMoved = false;
+                    printf("Warning - ship %d still has cargo which was not moved - index %d\n", ship->id, j);
+                    break;
+                }
+            }
+            
+            if (!allMoved) {
+                // Fix inconsistency - update the dock status
+                docks[i].allCargoMoved = false;
+                removeFromIdSet(&completedDocks, i);
+                continue;
+            }
+            
+            // Try to undock the ship with multiple attempts
+            bool undockSuccess = false;
+            for (int attempt = 0; attempt < 5; attempt++) {  // Try up to 5 times
+                if (undockShip(&docks[i])) {
+                    printf("Successfully undocked ship %d from dock %d on attempt %d\n", 
+                           ship->id, i, attempt + 1);
+                    markShipServiced(ship);
+                    undockSuccess = true;
+                    break;
+                }
+                
+                // Short delay between attempts
+                usleep(1000);  // 1ms delay
+            }
+            
+            if (!undockSuccess) {
+                printf("Failed to undock ship %d from dock %d after multiple attempts\n", ship->id, i);
+                undockingFailed = true;
+            }
+        }
+    }
+    
+    // Return the status of undocking operations
+    return !undockingFailed;
+}
+
+// True if some dock has a ship that finished its cargo before this timestep
+bool anyDockReadyToUndock() {
+    for (int k = 0; k < completedDocks.count; k++) {
+        if (docks[completedDocks.ids[k]].lastCargoMovedTimestep < currentTimestep) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Checkpoint file: a header followed by two slots. Each timestep boundary writes the
+// slot not holding the newest snapshot, with its sequence number stored last, so a
+// crash mid-write leaves the other slot intact. While checkpointing, the messages a
+// timestep produces are held back and stored in its snapshot before any is sent, so
+// validation never sees a decision the snapshot does not know about. The header keeps
+// the last message received from validation, which is replayed on restore if the
+// crashed run had not finished acting on it, and counts how much of the newest
+// snapshot's batch of messages has been sent.
+#define SNAPSHOT_MAGIC 0x53434845444b5031ULL
+#define SNAPSHOT_VERSION 1
+#define CARGO_MOVED_WORDS ((MAX_CARGO_COUNT + 63) / 64)
+#define SOLVER_DRAIN_POLL_US 100
+#define SOLVER_DRAIN_QUIET_POLLS 5  // empty polls in a row that end the drain
+#define SOLVER_DRAIN_MAX_POLLS 200  // bound on the drain if a solver keeps posting
+
+typedef struct SnapshotFileHeader {
+    uint64_t magic;
+    int version;
+    int numDocks;
+    size_t slotSize;
+    int receivedTimestep;          // timestep receivedMessage belongs to, 0 if none
+    MessageStruct receivedMessage;
+    uint64_t batchSequence;        // snapshot whose batch batchSent counts
+    long long batchSent;           // messages of that batch handed to msgsnd
+} SnapshotFileHeader;
+
+typedef struct SnapshotSlotHeader {
+    uint64_t sequence; // 0 while the slot is being written
+    uint64_t checksum; // over everything after this field, up to the last used ship
+    int currentTimestep;
+    int shipCount;
+    int batchCount; // messages for validation held back when the snapshot was taken
+} SnapshotSlotHeader;
+
+typedef struct SnapshotDock {
+    bool isOccupied;
+    bool allCargoMoved;
+    int shipIndex;
+    int dockingTimestep;
+    int lastCargoMovedTimestep;
+    int authSearchState;
+    int authStringLength;
+    char foundAuthString[100];
+    long long authCursor[8];
+} SnapshotDock;
+
+typedef struct SnapshotShip {
+    int id;
+    int direction;
+    int category;
+    int emergency;
+    int waitingTime;
+    int arrivalTimestep;
+    int numCargo;
+    int assignedDockId;
+    int cargosMovedCount;
+    int maxCargoWeight;
+    bool isServiced;
+    bool isAssignedDock;
+    bool isWaiting;
+    int cargo[MAX_CARGO_COUNT];
+    uint64_t cargoMoved[CARGO_MOVED_WORDS];
+} SnapshotShip;
+
+char *checkpointPath = NULL;
+bool restoreFromCheckpoint = false;
+char *checkpointMap = NULL;
+size_t checkpointSlotSize;
+int checkpointBatchCapacity;
+uint64_t checkpointSequence = 0;
+bool replayReceivedMessage = false;
+
+SnapshotFileHeader *checkpointHeader() {
+    return (SnapshotFileHeader *)checkpointMap;
+}
+
+SnapshotSlotHeader *checkpointSlot(int slot) {
+    return (SnapshotSlotHeader *)(checkpointMap + sizeof(SnapshotFileHeader) + slot * checkpointSlotSize);
+}
+
+SnapshotDock *slotDocks(SnapshotSlotHeader *slot) {
+    return (SnapshotDock *)(slot + 1);
+}
+
+MessageStruct *slotBatch(SnapshotSlotHeader *slot) {
+    return (MessageStruct *)(slotDocks(slot) + numDocks);
+}
+
+SnapshotShip *slotShips(SnapshotSlotHeader *slot) {
+    return (SnapshotShip *)(slotBatch(slot) + checkpointBatchCapacity);
+}
+
+uint64_t slotChecksum(SnapshotSlotHeader *slot, int shipCount) {
+    const unsigned char *start = (const unsigned char *)&slot->currentTimestep;
+    const unsigned char *end = (const unsigned char *)(slotShips(slot) + shipCount);
+    uint64_t hash = 1469598103934665603ULL; // FNV-1a
+    for (const unsigned char *p = start; p < end; p++) {
+        hash = (hash ^ *p) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool slotIsValid(SnapshotSlotHeader *slot) {
+    return slot->sequence != 0 && slot->shipCount >= 0 && slot->shipCount <= MAX_SHIP_REQUESTS &&
+           slot->batchCount >= 0 && slot->batchCount <= checkpointBatchCapacity &&
+           slot->checksum == slotChecksum(slot, slot->shipCount);
+}
+
+// Map the checkpoint file, creating it if needed. Returns the newest valid slot or -1.
+int openCheckpoint() {
+    // A timestep sends at most one dock or undock message per dock, one cargo move per
+    // crane, the timestep update and a completion message
+    checkpointBatchCapacity = 2 * numDocks + 2;
+    for (int i = 0; i < numDocks; i++) {
+        checkpointBatchCapacity += docks[i].category;
+    }
+    checkpointSlotSize = sizeof(SnapshotSlotHeader) + numDocks * sizeof(SnapshotDock) +
+                         checkpointBatchCapacity * sizeof(MessageStruct) +
+                         MAX_SHIP_REQUESTS * sizeof(SnapshotShip);
+    size_t fileSize = sizeof(SnapshotFileHeader) + 2 * checkpointSlotSize;
+
+    int fd = open(checkpointPath, O_RDWR | O_CREAT, 0666);
+    if (fd == -1) {
+        perror("Error opening checkpoint file");
+        exit(1);
+    }
+    if (ftruncate(fd, fileSize) == -1) {
+        perror("Error sizing checkpoint file");
+        exit(1);
+    }
+    checkpointMap = (char *)mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (checkpointMap == MAP_FAILED) {
+        perror("Error mapping checkpoint file");
+        exit(1);
+    }
+
+    SnapshotFileHeader *header = checkpointHeader();
+    if (header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION ||
+        header->numDocks != numDocks || header->slotSize != checkpointSlotSize) {
+        // Not a checkpoint of this port; start it afresh
+        memset(checkpointMap, 0, fileSize);
+        header->magic = SNAPSHOT_MAGIC;
+        header->version = SNAPSHOT_VERSION;
+        header->numDocks = numDocks;
+        header->slotSize = checkpointSlotSize;
+        return -1;
+    }
+
+    int newest = -1;
+    for (int slot = 0; slot < 2; slot++) {
+        SnapshotSlotHeader *candidate = checkpointSlot(slot);
+        if (slotIsValid(candidate) && (newest == -1 || candidate->sequence > checkpointSlot(newest)->sequence)) {
+            newest = slot;
+        }
+    }
+    if (newest != -1) {
+        checkpointSequence = checkpointSlot(newest)->sequence;
+    }
+    return newest;
+}
+
+// Snapshot the scheduler between timesteps, together with the messages the timestep
+// produced, then let those messages go out
+void writeCheckpoint() {
+    uint64_t sequence = checkpointSequence + 1;
+    SnapshotSlotHeader *slot = checkpointSlot(sequence % 2);
+
+    __atomic_store_n(&slot->sequence, 0, __ATOMIC_RELEASE);
+    slot->currentTimestep = currentTimestep;
+    slot->shipCount = shipCount;
+    slot->batchCount = copyHeldMessages(slotBatch(slot), checkpointBatchCapacity);
+    if (slot->batchCount == -1) {
+        fprintf(stderr, "Too many messages in timestep %d to checkpoint\n", currentTimestep - 1);
+        exit(1);
+    }
+
+    SnapshotDock *snapDocks = slotDocks(slot);
+    pthread_mutex_lock(&authWorker.mutex);
+    for (int i = 0; i < numDocks; i++) {
+        Dock *dock = &docks[i];
+        SnapshotDock *snap = &snapDocks[i];
+        memset(snap, 0, sizeof(SnapshotDock));
+        snap->isOccupied = dock->isOccupied;
+        snap->allCargoMoved = dock->allCargoMoved;
+        snap->shipIndex = dock->isOccupied ? dock->ship->index : -1;
+        snap->dockingTimestep = dock->dockingTimestep;
+        snap->lastCargoMovedTimestep = dock->lastCargoMovedTimestep;
+        snap->authSearchState = dock->authSearchState;
+        snap->authStringLength = dock->authStringLength;
+        if (dock->authSearchState == AUTH_SEARCH_DONE) {
+            strncpy(snap->foundAuthString, dock->foundAuthString, 100);
+        }
+        for (int t = 0; t < 8; t++) {
+            snap->authCursor[t] = __atomic_load_n(&dock->authCursor[t], __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&authWorker.mutex);
+
+    SnapshotShip *snapShips = slotShips(slot);
+    for (int i = 0; i < shipCount; i++) {
+        Ship *ship = ships[i];
+        SnapshotShip *snap = &snapShips[i];
+        memset(snap, 0, sizeof(SnapshotShip));
+        snap->id = ship->id;
+        snap->direction = ship->direction;
+        snap->category = ship->category;
+        snap->emergency = ship->emergency;
+        snap->waitingTime = ship->waitingTime;
+        snap->arrivalTimestep = ship->arrivalTimestep;
+        snap->numCargo = ship->numCargo;
+        snap->assignedDockId = ship->assignedDockId;
+        snap->cargosMovedCount = ship->cargosMovedCount;
+        snap->maxCargoWeight = ship->maxCargoWeight;
+        snap->isServiced = ship->isServiced;
+        snap->isAssignedDock = ship->isAssignedDock;
+        snap->isWaiting = waitingShips.position[i] != -1;
+        memcpy(snap->cargo, ship->cargo, ship->numCargo * sizeof(int));
+        for (int j = 0; j < ship->numCargo; j++) {
+            if (ship->cargoMoved[j]) {
+                snap->cargoMoved[j / 64] |= 1ULL << (j % 64);
+            }
+        }
+    }
+
+    slot->checksum = slotChecksum(slot, shipCount);
+    __atomic_store_n(&slot->sequence, sequence, __ATOMIC_RELEASE);
+    checkpointSequence = sequence;
+
+    // Nothing of the new batch is sent until the counter is tagged with its snapshot
+    SnapshotFileHeader *header = checkpointHeader();
+    __atomic_store_n(&header->batchSent, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&header->batchSequence, sequence, __ATOMIC_RELEASE);
+
+    // Let the kernel start writing back; a crash of this process alone loses nothing
+    msync(checkpointMap, sizeof(SnapshotFileHeader) + 2 * checkpointSlotSize, MS_ASYNC);
+    releaseOutboundMessages();
+    startCompletedAuthSearches();
+}
+
+// Remember the message just received, so a restore can act on it instead of waiting
+void checkpointReceivedMessage(MessageStruct *message) {
+    SnapshotFileHeader *header = checkpointHeader();
+    __atomic_store_n(&header->receivedTimestep, 0, __ATOMIC_RELEASE);
+    header->receivedMessage = *message;
+    __atomic_store_n(&header->receivedTimestep, currentTimestep, __ATOMIC_RELEASE);
+}
+
+// Discard guesses and verdicts the crashed run left in the solver queues, so a
+// restored search does not read a response meant for an earlier guess
+void drainSolverQueues() {
+    BatchSolverRequest stale; // large enough for every solver message type
+    // A solver that was mid-guess posts its last response within microseconds, so stop
+    // once every queue has stayed empty for a few polls in a row
+    int quietPolls = 0;
+    for (int poll = 0; poll < SOLVER_DRAIN_MAX_POLLS && quietPolls < SOLVER_DRAIN_QUIET_POLLS; poll++) {
+        bool drained = false;
+        for (int i = 0; i < numSolvers; i++) {
+            while (msgrcv(solverQueueIds[i], &stale, sizeof(BatchSolverRequest) - sizeof(long), 0, IPC_NOWAIT) != -1) {
+                drained = true;
+            }
+        }
+        quietPolls = drained ? 0 : quietPolls + 1;
+        usleep(SOLVER_DRAIN_POLL_US);
+    }
+}
+
+// Rebuild docks, ships and in-flight auth searches from a snapshot, and send the part
+// of its batch the crashed run did not get to
+void restoreSnapshot(int slotIndex) {
+    SnapshotSlotHeader *slot = checkpointSlot(slotIndex);
+    currentTimestep = slot->currentTimestep;
+
+    SnapshotFileHeader *header = checkpointHeader();
+    long long alreadySent = header->batchSequence == slot->sequence ? header->batchSent : 0;
+    MessageStruct *batch = slotBatch(slot);
+    for (int i = alreadySent; i < slot->batchCount; i++) {
+        queueMainMessage(&batch[i]);
+    }
+    releaseOutboundMessages();
+
+    SnapshotShip *snapShips = slotShips(slot);
+    for (int i = 0; i < slot->shipCount; i++) {
+        SnapshotShip *snap = &snapShips[i];
+        Ship *ship = (Ship *)malloc(sizeof(Ship));
+        if (ship == NULL) {
+            perror("Memory allocation failed for restored ship");
+            exit(1);
+        }
+        ship->id = snap->id;
+        ship->direction = snap->direction;
+        ship->category = snap->category;
+        ship->emergency = snap->emergency;
+        ship->waitingTime = snap->waitingTime;
+        ship->arrivalTimestep = snap->arrivalTimestep;
+        ship->numCargo = snap->numCargo;
+        ship->assignedDockId = snap->assignedDockId;
+        ship->cargosMovedCount = snap->cargosMovedCount;
+        ship->maxCargoWeight = snap->maxCargoWeight;
+        ship->isServiced = snap->isServiced;
+        ship->isAssignedDock = snap->isAssignedDock;
+        ship->priority = 0;
+        ship->cargo = (int *)malloc(ship->numCargo * sizeof(int));
+        if (ship->cargo == NULL) {
+            perror("Memory allocation failed for restored cargo");
+            exit(1);
+        }
+        memcpy(ship->cargo, snap->cargo, ship->numCargo * sizeof(int));
+        for (int j = 0; j < ship->numCargo; j++) {
+            ship->cargoMoved[j] = (snap->cargoMoved[j / 64] >> (j % 64)) & 1;
+        }
+        computeDockCompatibility(ship);
+
+        ship->index = shipCount;
+        ships[shipCount++] = ship;
+        shipTable[shipTableSlot(ship->id, ship->direction)] = ship;
+        if (!ship->isServiced) {
+            unservicedShipCount++;
+        }
+        if (snap->isWaiting) {
+            addToIdSet(&waitingShips, ship->index);
+        }
+    }
+
+    SnapshotDock *snapDocks = slotDocks(slot);
     for (int i = 0; i < numDocks; i++) {
-        if (!docks[i].isOccupied) {
+        Dock *dock = &docks[i];
+        SnapshotDock *snap = &snapDocks[i];
+        if (!snap->isOccupied) {
             continue;
         }
-        
-        // Print dock status
-        //printf("Dock %d status: occupied by ship %d, allCargoMoved=%d, lastCargoMoved=%d\n", 
-               //i, docks[i].occupiedByShipId, docks[i].allCargoMoved, docks[i].lastCargoMovedTimestep);
-        
-        // Try to undock if all cargo moved and it's not the same timestep as the last cargo movement
-        if (docks[i].allCargoMoved && docks[i].lastCargoMovedTimestep < currentTimestep) {
-            // Find the ship at this dock
-            Ship *ship = NULL;
-            for (int j = 0; j < shipCount; j++) {
-                if (ships[j]->id == docks[i].occupiedByShipId && 
-                    ships[j]->direction == docks[i].occupiedByDirection && 
-                    ships[j]->isAssignedDock && 
-                    ships[j]->assignedDockId == i) {
-                    ship = ships[j];
-                    break;
-                }
-            }
-            
-            if (ship == NULL) {
-                printf("Warning: No ship found at dock %d for undocking\n", i);
-                continue;
-            }
-            
-            //printf("Attempting to undock ship %d from dock %d\n", ship->id, i);
-            
-            // Double-check that all cargo has been moved
-            bool allMoved = true;
-            for (int j = 0; j < ship->numCargo; j++) {
-                if (!ship->cargoMoved[j]) {
-                    allMoved = false;
-                    printf("Warning - ship %d still has cargo which was not moved - index %d\n", ship->id, j);
-                    break;
-                }
-            }
-            
-            if (!allMoved) {
-                // Fix inconsistency - update the dock status
-                docks[i].allCargoMoved = false;
-                continue;
-            }
-            
-            // Try to undock the ship with multiple attempts
-            bool undockSuccess = false;
-            for (int attempt = 0; attempt < 5; attempt++) {  // Try up to 5 times
-                if (undockShip(&docks[i])) {
-                    printf("Successfully undocked ship %d from dock %d on attempt %d\n", 
-                           ship->id, i, attempt + 1);
-                    ship->isServiced = true;
-                    ship->isAssignedDock = false;
-                    undockSuccess = true;
-                    break;
-                }
-                
-                // Short delay between attempts
-                usleep(1000);  // 1ms delay
-            }
-            
-            if (!undockSuccess) {
-                printf("Failed to undock ship %d from dock %d after multiple attempts\n", ship->id, i);
-                undockingFailed = true;
-            }
+
+        Ship *ship = ships[snap->shipIndex];
+        dock->isOccupied = true;
+        dock->ship = ship;
+        dock->occupiedByShipId = ship->id;
+        dock->occupiedByDirection = ship->direction;
+        dock->dockingTimestep = snap->dockingTimestep;
+        dock->lastCargoMovedTimestep = snap->lastCargoMovedTimestep;
+        dock->allCargoMoved = snap->allCargoMoved;
+        freeDockBits[dock->rank / 64] &= ~(1ULL << (dock->rank % 64));
+        addToIdSet(&occupiedDocks, i);
+        if (!dock->allCargoMoved) {
+            continue;
+        }
+        addToIdSet(&completedDocks, i);
+
+        if (snap->authSearchState == AUTH_SEARCH_DONE) {
+            strncpy(dock->foundAuthString, snap->foundAuthString, 100);
+            dock->authStringLength = snap->authStringLength;
+            dock->authSearchState = AUTH_SEARCH_DONE;
+        } else {
+            // Pick the search up where its solver threads had got to
+            memcpy(dock->authCursor, snap->authCursor, sizeof(dock->authCursor));
+            dock->authResume = snap->authSearchState == AUTH_SEARCH_PENDING;
         }
     }
-    
-    // Return the status of undocking operations
-    return !undockingFailed;
+    startCompletedAuthSearches();
+
+    printf("Restored checkpoint at timestep %d: %d ships, %d occupied docks, %lld of %d messages resent\n",
+           currentTimestep, shipCount, occupiedDocks.count,
+           slot->batchCount - alreadySent, slot->batchCount);
+}
+
+void restoreCheckpoint(int newest) {
+    drainSolverQueues();
+
+    if (newest == -1) {
+        printf("No valid checkpoint in %s, starting from the beginning\n", checkpointPath);
+    } else {
+        restoreSnapshot(newest);
+    }
+
+    // Nothing the crashed run decided after the snapshot reached validation, so the
+    // message it was working on is acted on again from scratch
+    SnapshotFileHeader *header = checkpointHeader();
+    replayReceivedMessage = header->receivedTimestep == currentTimestep ||
+                            (header->receivedTimestep != 0 && header->receivedMessage.isFinished == 1);
+}
+
+void startCheckpointing() {
+    if (checkpointPath == NULL) {
+        return;
+    }
+    int newest = openCheckpoint();
+    holdOutboundMessages();
+    outboundQueue.sentCounter = &checkpointHeader()->batchSent;
+    if (restoreFromCheckpoint) {
+        restoreCheckpoint(newest);
+    }
+}
+
+// Next message from the validation module, or the one a restored checkpoint had received
+void receiveValidationMessage(MessageStruct *message) {
+    if (replayReceivedMessage) {
+        *message = checkpointHeader()->receivedMessage;
+        replayReceivedMessage = false;
+        return;
+    }
+
+    if (msgrcv(mainQueueId, message, sizeof(MessageStruct) - sizeof(long), 1, 0) == -1) {
+        perror("Error receiving message from validation");
+        exit(1);
+    }
+
+    if (checkpointMap != NULL) {
+        checkpointReceivedMessage(message);
+    }
 }
 
 bool updateTimestep() {
@@ -696,13 +2228,8 @@ bool updateTimestep() {
         undockingCompleted = true;
         
         // Check for ships that need undocking
-        for (int i = 0; i < numDocks; i++) {
-            if (docks[i].isOccupied && docks[i].allCargoMoved && 
-                docks[i].lastCargoMovedTimestep < currentTimestep) {
-                undockingCompleted = false;
-               // printf("Dock %d has ship %d needing undocking\n", i, docks[i].occupiedByShipId);
-                break;
-            }
+        if (anyDockReadyToUndock()) {
+            undockingCompleted = false;
         }
         
         if (!undockingCompleted) {
@@ -721,12 +2248,14 @@ bool updateTimestep() {
     MessageStruct message;
     message.mtype = 5;
     
-    if (msgsnd(mainQueueId, &message, sizeof(MessageStruct) - sizeof(long), 0) == -1) {
-        perror("Error sending timestep update message");
-        exit(1);
-    }
+    queueMainMessage(&message);
     
     currentTimestep++;
+    clearIdSet(&arrivedShips);
+    
+    if (checkpointMap != NULL) {
+        writeCheckpoint();
+    }
     return true;
 }
 
@@ -740,122 +2269,241 @@ bool moveCargoItem(Ship *ship, Dock *dock, int cargoId, int craneId) {
     message.cargoId = cargoId;
     message.craneId = craneId;
     
-    if (msgsnd(mainQueueId, &message, sizeof(MessageStruct) - sizeof(long), 0) == -1) {
-        perror("Error sending cargo movement message");
-        exit(1);
-    }
+    queueMainMessage(&message);
     
     return true;
 }
 
-void moveCargoItems() {
-    // Create an array to track which cranes have been used in this timestep
-    bool usedCranes[MAX_DOCKS][MAX_CARGO_COUNT] = {false};
+// Plan this timestep's cargo moves for one dock and apply them to the dock and its ship.
+// Touches nothing outside the dock and its ship, so docks can be planned in parallel;
+// the messages are sent afterwards in dock order.
+void planDockCargo(Dock *dock) {
+    dock->plannedCount = 0;
+    
+    // Find the ship at this dock
+    Ship *ship = shipAtDock(dock);
+    if (ship == NULL) {
+        return;
+    }
     
-    // Process docks in order
-    for (int i = 0; i < numDocks; i++) {
-        // Skip if dock is not occupied or was just assigned this timestep
-        if (!docks[i].isOccupied || docks[i].dockingTimestep >= currentTimestep) {
-            continue;
+    // Check if all cargo already moved
+    if (ship->cargosMovedCount >= ship->numCargo) {
+        dock->allCargoMoved = true;
+        return;
+    }
+    
+    // Get unmoved cargo indices and sort by weight (descending)
+    int cargoIndices[MAX_CARGO_COUNT];
+    int cargoCount = 0;
+    
+    for (int j = 0; j < ship->numCargo; j++) {
+        if (!ship->cargoMoved[j]) {
+            cargoIndices[cargoCount++] = j;
         }
+    }
+    
+    // Sort by cargo weight (descending)
+    for (int j = 0; j < cargoCount - 1; j++) {
+        for (int k = 0; k < cargoCount - j - 1; k++) {
+            if (ship->cargo[cargoIndices[k]] < ship->cargo[cargoIndices[k + 1]]) {
+                int temp = cargoIndices[k];
+                cargoIndices[k] = cargoIndices[k + 1];
+                cargoIndices[k + 1] = temp;
+            }
+        }
+    }
+    
+    // First pass: Try optimal assignments (cargo to smallest sufficient crane)
+    for (int j = 0; j < cargoCount && dock->plannedCount < dock->category; j++) {
+        int cargoIdx = cargoIndices[j];
+        int cargoWeight = ship->cargo[cargoIdx];
         
-        // Find the ship at this dock
-        Ship *ship = NULL;
-        for (int j = 0; j < shipCount; j++) {
-            if (ships[j]->id == docks[i].occupiedByShipId && 
-                ships[j]->direction == docks[i].occupiedByDirection && 
-                ships[j]->isAssignedDock && 
-                ships[j]->assignedDockId == i) {
-                ship = ships[j];
+        // Try to find the smallest crane that can handle this cargo
+        for (int k = 0; k < dock->category; k++) {
+            if (dock->craneUsedTimestep[k] != currentTimestep && dock->craneCapacities[k] >= cargoWeight) {
+                // We found a crane that can handle this cargo
+                dock->plannedCargo[dock->plannedCount] = cargoIdx;
+                dock->plannedCranes[dock->plannedCount] = k;
+                dock->plannedCount++;
+                
+                ship->cargoMoved[cargoIdx] = true;
+                ship->cargosMovedCount++;
+                dock->lastCargoMovedTimestep = currentTimestep;
+                dock->craneUsedTimestep[k] = currentTimestep;
                 break;
             }
         }
-        
-        if (ship == NULL) {
-            printf("Warning: No ship found at dock %d\n", i);
-            continue;
+    }
+    
+    // Check if all cargo has been moved now
+    if (ship->cargosMovedCount == ship->numCargo) {
+        dock->allCargoMoved = true;
+    }
+}
+
+// Worker pool that plans independent docks in parallel on large ports
+typedef struct PlanningPool {
+    pthread_t *threads;
+    int numThreads;
+    int *dockIds;     // docks to plan in the current round
+    int dockCount;
+    int nextDock;     // next index into dockIds to claim
+    int round;        // bumped to start a round
+    int busyWorkers;
+    bool stopping;
+    pthread_mutex_t mutex;
+    pthread_cond_t roundStarted;
+    pthread_cond_t roundFinished;
+} PlanningPool;
+
+PlanningPool planningPool = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .roundStarted = PTHREAD_COND_INITIALIZER,
+    .roundFinished = PTHREAD_COND_INITIALIZER
+};
+
+void planClaimedDocks() {
+    int index;
+    while ((index = __atomic_fetch_add(&planningPool.nextDock, 1, __ATOMIC_RELAXED)) < planningPool.dockCount) {
+        planDockCargo(&docks[planningPool.dockIds[index]]);
+    }
+}
+
+void* planningWorker(void* arg) {
+    (void)arg;
+    int seenRound = 0;
+    pthread_mutex_lock(&planningPool.mutex);
+    while (true) {
+        while (planningPool.round == seenRound && !planningPool.stopping) {
+            pthread_cond_wait(&planningPool.roundStarted, &planningPool.mutex);
         }
-        
-        // Check if all cargo already moved
-        if (ship->cargosMovedCount >= ship->numCargo) {
-            docks[i].allCargoMoved = true;
-            continue;
+        if (planningPool.stopping) {
+            break;
         }
-        
-        // Get unmoved cargo indices and sort by weight (descending)
-        int cargoIndices[MAX_CARGO_COUNT];
-        int cargoCount = 0;
-        
-        for (int j = 0; j < ship->numCargo; j++) {
-            if (!ship->cargoMoved[j]) {
-                cargoIndices[cargoCount++] = j;
-            }
+        seenRound = planningPool.round;
+        pthread_mutex_unlock(&planningPool.mutex);
+
+        planClaimedDocks();
+
+        pthread_mutex_lock(&planningPool.mutex);
+        if (--planningPool.busyWorkers == 0) {
+            pthread_cond_signal(&planningPool.roundFinished);
         }
-        
-        // Sort by cargo weight (descending)
-        for (int j = 0; j < cargoCount - 1; j++) {
-            for (int k = 0; k < cargoCount - j - 1; k++) {
-                if (ship->cargo[cargoIndices[k]] < ship->cargo[cargoIndices[k + 1]]) {
-                    int temp = cargoIndices[k];
-                    cargoIndices[k] = cargoIndices[k + 1];
-                    cargoIndices[k + 1] = temp;
-                }
-            }
+    }
+    pthread_mutex_unlock(&planningPool.mutex);
+    return NULL;
+}
+
+// One worker per extra core; the main thread plans alongside them
+void startPlanningPool() {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    planningPool.numThreads = 0;
+    if (numDocks < PARALLEL_PLANNING_MIN_DOCKS || cores <= 1) {
+        return;
+    }
+
+    int numThreads = (int)(cores > MAX_PLANNING_THREADS ? MAX_PLANNING_THREADS : cores) - 1;
+    planningPool.threads = (pthread_t *)malloc(numThreads * sizeof(pthread_t));
+    if (planningPool.threads == NULL) {
+        perror("Memory allocation failed for planning pool");
+        exit(1);
+    }
+    for (int i = 0; i < numThreads; i++) {
+        if (pthread_create(&planningPool.threads[i], NULL, planningWorker, NULL) != 0) {
+            perror("Failed to create planning thread");
+            // Continue with fewer threads if creation fails
+            break;
+        }
+        planningPool.numThreads++;
+    }
+}
+
+void stopPlanningPool() {
+    if (planningPool.numThreads == 0) {
+        return;
+    }
+    pthread_mutex_lock(&planningPool.mutex);
+    planningPool.stopping = true;
+    pthread_cond_broadcast(&planningPool.roundStarted);
+    pthread_mutex_unlock(&planningPool.mutex);
+
+    for (int i = 0; i < planningPool.numThreads; i++) {
+        pthread_join(planningPool.threads[i], NULL);
+    }
+    free(planningPool.threads);
+}
+
+void planDocks(int *dockIds, int dockCount) {
+    if (planningPool.numThreads == 0 || dockCount < PARALLEL_PLANNING_MIN_DOCKS) {
+        for (int k = 0; k < dockCount; k++) {
+            planDockCargo(&docks[dockIds[k]]);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&planningPool.mutex);
+    planningPool.dockIds = dockIds;
+    planningPool.dockCount = dockCount;
+    planningPool.nextDock = 0;
+    planningPool.busyWorkers = planningPool.numThreads;
+    planningPool.round++;
+    pthread_cond_broadcast(&planningPool.roundStarted);
+    pthread_mutex_unlock(&planningPool.mutex);
+
+    planClaimedDocks();
+
+    pthread_mutex_lock(&planningPool.mutex);
+    while (planningPool.busyWorkers > 0) {
+        pthread_cond_wait(&planningPool.roundFinished, &planningPool.mutex);
+    }
+    pthread_mutex_unlock(&planningPool.mutex);
+}
+
+void moveCargoItems() {
+    // Collect occupied docks in order, skipping docks that were just assigned this timestep
+    int dockIds[occupiedDocks.count + 1];
+    int occupiedCount = sortedIdSet(&occupiedDocks, dockIds);
+    int dockCount = 0;
+    for (int k = 0; k < occupiedCount; k++) {
+        if (docks[dockIds[k]].dockingTimestep < currentTimestep) {
+            dockIds[dockCount++] = dockIds[k];
         }
+    }
+    
+    planDocks(dockIds, dockCount);
+    
+    // Send the planned moves in dock order
+    for (int k = 0; k < dockCount; k++) {
+        Dock *dock = &docks[dockIds[k]];
+        Ship *ship = shipAtDock(dock);
         
-        // Try to match cargo with cranes optimally
-        int cargoProcessed = 0;
+        if (ship == NULL) {
+            printf("Warning: No ship found at dock %d\n", dock->id);
+            continue;
+        }
         
-        // First pass: Try optimal assignments (cargo to smallest sufficient crane)
-        for (int j = 0; j < cargoCount; j++) {
-            int cargoIdx = cargoIndices[j];
-            int cargoWeight = ship->cargo[cargoIdx];
-            
-            // Try to find the smallest crane that can handle this cargo
-            for (int k = 0; k < docks[i].category; k++) {
-                if (!usedCranes[i][k] && docks[i].craneCapacities[k] >= cargoWeight) {
-                    // We found a crane that can handle this cargo
-                    if (moveCargoItem(ship, &docks[i], cargoIdx, k)) {
-                        ship->cargoMoved[cargoIdx] = true;
-                        ship->cargosMovedCount++;
-                        docks[i].lastCargoMovedTimestep = currentTimestep;
-                        usedCranes[i][k] = true;
-                        cargoProcessed++;
-                        break;
-                    }
-                }
-            }
+        for (int j = 0; j < dock->plannedCount; j++) {
+            moveCargoItem(ship, dock, dock->plannedCargo[j], dock->plannedCranes[j]);
         }
         
-        // Check if all cargo has been moved now
-        if (ship->cargosMovedCount == ship->numCargo) {
-            docks[i].allCargoMoved = true;
-            //printf("All cargo moved for ship %d at dock %d\n", ship->id, i);
-        } else {
-            // printf("Processed %d cargo items this timestep for ship %d at dock %d (%d/%d total)\n", 
-            //        cargoProcessed, ship->id, i, ship->cargosMovedCount, ship->numCargo);
+        if (dock->allCargoMoved) {
+            addToIdSet(&completedDocks, dock->id);
+            startAuthSearch(dock);
+            //printf("All cargo moved for ship %d at dock %d\n", ship->id, dock->id);
         }
     }
 }
 
-bool canDockShip(Ship *ship, Dock *dock) {
-    // Check if dock is free
-    if (dock->isOccupied) {
-        return false;
-    }
-    
-    // Check category constraint
-    if (dock->category < ship->category) {
-        return false;
-    }
-    
-    // Check if any crane can handle the max cargo weight
-    if (dock->maxCraneCapacity < ship->maxCargoWeight) {
-        return false;
+// First free dock, in (category, id) order, whose bit is set in the ship's compatibility
+// bitset; NULL if there is none
+Dock *findFreeCompatibleDock(Ship *ship) {
+    for (int w = 0; w < dockWords; w++) {
+        uint64_t candidates = ship->compatibleDocks[w] & freeDockBits[w];
+        if (candidates != 0) {
+            return &docks[dockAtRank[w * 64 + __builtin_ctzll(candidates)]];
+        }
     }
-    
-    // All checks passed
-    return true;
+    return NULL;
 }
 
 void dockShip(Ship *ship, Dock *dock) {
@@ -866,16 +2514,18 @@ void dockShip(Ship *ship, Dock *dock) {
     message.direction = ship->direction;
     message.dockId = dock->id;
     
-    if (msgsnd(mainQueueId, &message, sizeof(MessageStruct) - sizeof(long), 0) == -1) {
-        perror("Error sending dock assignment message");
-        exit(1);
-    }
+    queueMainMessage(&message);
     
     // Update ship and dock status
     ship->isAssignedDock = true;
     ship->assignedDockId = dock->id;
     
+    removeFromIdSet(&waitingShips, ship->index);
+    
     dock->isOccupied = true;
+    dock->ship = ship;
+    freeDockBits[dock->rank / 64] &= ~(1ULL << (dock->rank % 64));
+    addToIdSet(&occupiedDocks, dock->id);
     dock->occupiedByShipId = ship->id;
     dock->occupiedByDirection = ship->direction;
     dock->dockingTimestep = currentTimestep;
@@ -888,22 +2538,26 @@ void performDockAssignment() {
     Ship *sortedShips[MAX_SHIP_REQUESTS];
     int sortedShipCount = 0;
     
-    for (int i = 0; i < shipCount; i++) {
-        if (!ships[i]->isAssignedDock && !ships[i]->isServiced) {
-            // Skip emergency ships as they are handled separately
-            if (ships[i]->direction == 1 && ships[i]->emergency == 1) {
+    int shipIds[MAX_SHIP_REQUESTS];
+    int waitingCount = sortedIdSet(&waitingShips, shipIds);
+    for (int k = 0; k < waitingCount; k++) {
+        Ship *ship = ships[shipIds[k]];
+        
+        // Skip emergency ships as they are handled separately
+        if (ship->direction == 1 && ship->emergency == 1) {
+            continue;
+        }
+        
+        // For regular ships, check if they are within waiting time
+        if (ship->direction == 1 && ship->waitingTime >= 0) {
+            if (currentTimestep > ship->arrivalTimestep + ship->waitingTime) {
+                // Waiting time has expired; the ship comes back as a new request if it returns
+                removeFromIdSet(&waitingShips, ship->index);
                 continue;
             }
-            
-            // For regular ships, check if they are within waiting time
-            if (ships[i]->direction == 1 && ships[i]->waitingTime >= 0) {
-                if (currentTimestep > ships[i]->arrivalTimestep + ships[i]->waitingTime) {
-                    continue;  // Skip this ship as its waiting time has expired
-                }
-            }
-            
-            sortedShips[sortedShipCount++] = ships[i];
         }
+        
+        sortedShips[sortedShipCount++] = ship;
     }
     
     // Sort by priority (descending)
@@ -917,40 +2571,14 @@ void performDockAssignment() {
         }
     }
     
-    // Find and sort free docks
-    Dock *freeDocks[MAX_DOCKS];
-    int freeDockCount = 0;
-    
-    for (int i = 0; i < numDocks; i++) {
-        if (!docks[i].isOccupied) {
-            freeDocks[freeDockCount++] = &docks[i];
-        }
-    }
-    
-    // Sort docks by category (ascending) to use smaller docks first
-    for (int i = 0; i < freeDockCount - 1; i++) {
-        for (int j = 0; j < freeDockCount - i - 1; j++) {
-            if (freeDocks[j]->category > freeDocks[j + 1]->category) {
-                Dock *temp = freeDocks[j];
-                freeDocks[j] = freeDocks[j + 1];
-                freeDocks[j + 1] = temp;
-            }
-        }
-    }
-    
     // Assign docks to ships
     for (int i = 0; i < sortedShipCount; i++) {
         Ship *ship = sortedShips[i];
         
         // Find the smallest adequate dock for this ship
-        for (int j = 0; j < freeDockCount; j++) {
-            if (canDockShip(ship, freeDocks[j])) {
-                dockShip(ship, freeDocks[j]);
-                
-                // Mark dock as used
-                freeDocks[j] = freeDocks[--freeDockCount];
-                break;
-            }
+        Dock *dock = findFreeCompatibleDock(ship);
+        if (dock != NULL) {
+            dockShip(ship, dock);
         }
     }
 }
@@ -985,9 +2613,12 @@ void assignDocksToEmergencyShips() {
     int emergencyShipCount = 0;
     Ship *emergencyShips[MAX_SHIP_REQUESTS];
     
-    for (int i = 0; i < shipCount; i++) {
-        if (ships[i]->direction == 1 && ships[i]->emergency == 1 && !ships[i]->isAssignedDock && !ships[i]->isServiced) {
-            emergencyShips[emergencyShipCount++] = ships[i];
+    int shipIds[MAX_SHIP_REQUESTS];
+    int waitingCount = sortedIdSet(&waitingShips, shipIds);
+    for (int k = 0; k < waitingCount; k++) {
+        Ship *ship = ships[shipIds[k]];
+        if (ship->direction == 1 && ship->emergency == 1) {
+            emergencyShips[emergencyShipCount++] = ship;
         }
     }
     
@@ -998,54 +2629,18 @@ void assignDocksToEmergencyShips() {
     // Sort emergency ships by arrival time and then by category (ascending)
     sortEmergencyShips(emergencyShips, emergencyShipCount);
     
-    // Count free docks
-    int freeDockCount = 0;
-    Dock *freeDocks[MAX_DOCKS];
-    
-    for (int i = 0; i < numDocks; i++) {
-        if (!docks[i].isOccupied) {
-            freeDocks[freeDockCount++] = &docks[i];
-        }
-    }
-    
-    if (freeDockCount == 0) {
-        return;  // No free docks available
-    }
-    
-    // Sort free docks by category (descending)
-    for (int i = 0; i < freeDockCount - 1; i++) {
-        for (int j = 0; j < freeDockCount - i - 1; j++) {
-            if (freeDocks[j]->category < freeDocks[j + 1]->category) {
-                Dock *temp = freeDocks[j];
-                freeDocks[j] = freeDocks[j + 1];
-                freeDocks[j + 1] = temp;
-            }
-        }
-    }
-    
     // Try to assign as many emergency ships as possible to free docks
-    bool *dockAssigned = (bool *)calloc(freeDockCount, sizeof(bool));
-    
     for (int i = 0; i < emergencyShipCount; i++) {
         Ship *ship = emergencyShips[i];
         
         // Find the smallest category dock that can accommodate this ship
         // and has a crane that can handle the max cargo weight
-        for (int j = freeDockCount - 1; j >= 0; j--) {
-            if (!dockAssigned[j] && 
-                freeDocks[j]->category >= ship->category && 
-                freeDocks[j]->maxCraneCapacity >= ship->maxCargoWeight) {
-                
-                dockAssigned[j] = true;
-                
-                // Send dock assignment message
-                dockShip(ship, freeDocks[j]);
-                break;
-            }
+        Dock *dock = findFreeCompatibleDock(ship);
+        if (dock != NULL) {
+            // Send dock assignment message
+            dockShip(ship, dock);
         }
     }
-    
-    free(dockAssigned);
 }
 
 void processAllRequests() {
@@ -1055,10 +2650,7 @@ void processAllRequests() {
     while (!finished) {
         // Read message from validation module
         MessageStruct message;
-        if (msgrcv(mainQueueId, &message, sizeof(MessageStruct) - sizeof(long), 1, 0) == -1) {
-            perror("Error receiving message from validation");
-            exit(1);
-        }
+        receiveValidationMessage(&message);
         
         // Save message info to global message 
         globalMessage = message;
@@ -1085,22 +2677,15 @@ void processAllRequests() {
                     undockingCompleted = true;
                     
                     // Check for ships that need undocking
-                    for (int i = 0; i < numDocks; i++) {
-                        if (docks[i].isOccupied && docks[i].allCargoMoved && 
-                            docks[i].lastCargoMovedTimestep < currentTimestep) {
+                    int dockIds[completedDocks.count + 1];
+                    int dockCount = sortedIdSet(&completedDocks, dockIds);
+                    for (int k = 0; k < dockCount; k++) {
+                        int i = dockIds[k];
+                        if (docks[i].lastCargoMovedTimestep < currentTimestep) {
                             undockingCompleted = false;
                             
                             // Find the ship at this dock
-                            Ship *ship = NULL;
-                            for (int j = 0; j < shipCount; j++) {
-                                if (ships[j]->id == docks[i].occupiedByShipId && 
-                                    ships[j]->direction == docks[i].occupiedByDirection &&
-                                    ships[j]->isAssignedDock && 
-                                    ships[j]->assignedDockId == i) {
-                                    ship = ships[j];
-                                    break;
-                                }
-                            }
+                            Ship *ship = shipAtDock(&docks[i]);
                             
                             if (ship != NULL) {
                                 printf("Attempting to undock ship %d from dock %d (completion phase)\n", 
@@ -1108,8 +2693,7 @@ void processAllRequests() {
                                 
                                 if (undockShip(&docks[i])) {
                                     printf("Successfully undocked ship %d from dock %d\n", ship->id, i);
-                                    ship->isServiced = true;
-                                    ship->isAssignedDock = false;
+                                    markShipServiced(ship);
                                 } else {
                                     printf("Failed to undock ship %d from dock %d\n", ship->id, i);
                                 }
@@ -1134,10 +2718,7 @@ void processAllRequests() {
             completionMsg.isFinished = 1;
             
             printf("All ships serviced. Sending completion message.\n");
-            if (msgsnd(mainQueueId, &completionMsg, sizeof(MessageStruct) - sizeof(long), 0) == -1) {
-                perror("Error sending completion message");
-                exit(1);
-            }
+            queueMainMessage(&completionMsg);
             
             completion = 1;
             break;
@@ -1162,10 +2743,7 @@ void processAllRequests() {
             completionMsg.isFinished = 1;
             
             printf("All ships already serviced. Sending completion message.\n");
-            if (msgsnd(mainQueueId, &completionMsg, sizeof(MessageStruct) - sizeof(long), 0) == -1) {
-                perror("Error sending completion message");
-                exit(1);
-            }
+            queueMainMessage(&completionMsg);
         }
         
         // Process ships in priority order
@@ -1175,26 +2753,20 @@ void processAllRequests() {
         
         // Ensure all occupied docks performed an action this timestep
         bool allDocksActive = true;
-        for (int i = 0; i < numDocks; i++) {
-            if (docks[i].isOccupied) {
-                // Check if this dock performed cargo movement this timestep
-                if (docks[i].lastCargoMovedTimestep < currentTimestep && !docks[i].allCargoMoved) {
-                    printf("Warning: Dock %d with ship %d did not perform any cargo movement this timestep\n",
-                           i, docks[i].occupiedByShipId);
-                    
-                    // Check if this dock has any cargo left to move
-                    Ship *ship = NULL;
-                    for (int j = 0; j < shipCount; j++) {
-                        if (ships[j]->id == docks[i].occupiedByShipId && 
-                            ships[j]->direction == docks[i].occupiedByDirection) {
-                            ship = ships[j];
-                            break;
-                        }
-                    }
-                    
-                    if (ship != NULL && ship->cargosMovedCount < ship->numCargo) {
-                        allDocksActive = false;
-                    }
+        int dockIds[occupiedDocks.count + 1];
+        int dockCount = sortedIdSet(&occupiedDocks, dockIds);
+        for (int k = 0; k < dockCount; k++) {
+            int i = dockIds[k];
+            // Check if this dock performed cargo movement this timestep
+            if (docks[i].lastCargoMovedTimestep < currentTimestep && !docks[i].allCargoMoved) {
+                printf("Warning: Dock %d with ship %d did not perform any cargo movement this timestep\n",
+                       i, docks[i].occupiedByShipId);
+                
+                // Check if this dock has any cargo left to move
+                Ship *ship = shipAtDock(&docks[i]);
+                
+                if (ship != NULL && ship->cargosMovedCount < ship->numCargo) {
+                    allDocksActive = false;
                 }
             }
         }
@@ -1206,15 +2778,7 @@ void processAllRequests() {
         }
         
         // Ensure undocking is attempted and completed for ships that are ready
-        bool undockingAttempted = false;
-        for (int i = 0; i < numDocks; i++) {
-            if (docks[i].isOccupied && docks[i].allCargoMoved &&
-                docks[i].lastCargoMovedTimestep < currentTimestep) {
-                //printf("Ship at dock %d has completed cargo operations and should be undocked\n", i);
-                undockingAttempted = true;
-                break;
-            }
-        }
+        bool undockingAttempted = anyDockReadyToUndock();
         
         if (undockingAttempted) {
             // Attempt undocking for all eligible ships
@@ -1222,21 +2786,16 @@ void processAllRequests() {
             
             // Check if any ships still need undocking
             bool stillNeedUndocking = false;
-            for (int i = 0; i < numDocks; i++) {
-                if (docks[i].isOccupied && docks[i].allCargoMoved &&
-                    docks[i].lastCargoMovedTimestep < currentTimestep) {
+            int dockIds[completedDocks.count + 1];
+            int dockCount = sortedIdSet(&completedDocks, dockIds);
+            for (int k = 0; k < dockCount; k++) {
+                int i = dockIds[k];
+                if (docks[i].lastCargoMovedTimestep < currentTimestep) {
                     //printf("Ship at dock %d still needs undocking after attempt\n", i);
                     stillNeedUndocking = true;
                     
                     // try one more aggressive attempt to  undock
-                    Ship *ship = NULL;
-                    for (int j = 0; j < shipCount; j++) {
-                        if (ships[j]->id == docks[i].occupiedByShipId && 
-                            ships[j]->direction == docks[i].occupiedByDirection) {
-                            ship = ships[j];
-                            break;
-                        }
-                    }
+                    Ship *ship = shipAtDock(&docks[i]);
                     
                     if (ship != NULL) {
                         //printf("Making extra attempt to undock ship %d from dock %d\n", ship->id, i);
@@ -1244,8 +2803,7 @@ void processAllRequests() {
                         // Retry undocking with more attempts for guessing auth string
                         if (undockShip(&docks[i])) {
                            // printf("Successfully undocked ship %d on extra attempt\n", ship->id);
-                            ship->isServiced = true;
-                            ship->isAssignedDock = false;
+                            markShipServiced(ship);
                         }
                     }
                 }
@@ -1261,17 +2819,49 @@ void processAllRequests() {
     }
 }
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <test_case_number>\n", argv[0]);
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <test_case_number> [--history-order] [--batch-guesses] [--policy <file>] [--checkpoint <file>] [--restore <file>]\n", argv[0]);
         return 1;
     }
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--history-order") == 0) {
+            guessOrder = GUESS_ORDER_HISTORY;
+        } else if (strcmp(argv[i], "--batch-guesses") == 0) {
+            batchGuesses = true;
+        } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            loadPolicy(argv[++i]);
+        } else if ((strcmp(argv[i], "--checkpoint") == 0 || strcmp(argv[i], "--restore") == 0) && i + 1 < argc) {
+            restoreFromCheckpoint = restoreFromCheckpoint || strcmp(argv[i], "--restore") == 0;
+            checkpointPath = argv[++i];
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
     char filename[256];
     snprintf(filename, sizeof(filename), "testcase%s/input.txt", argv[1]);
 
     initializeIPC(filename);
+    if (batchGuesses) {
+        negotiateBatchGuesses();
+    }
+
+    initCandidateDecoding();
+    startOutboundSender();
+    startAuthWorker();
+    startPlanningPool();
+    startCheckpointing();
 
     processAllRequests();
 
+    // Make sure the final messages reach the validation module before exiting
+    flushOutboundQueue();
+    stopOutboundSender();
+    stopAuthWorker();
+    stopPlanningPool();
+
+    printAuthSearchStats();
+
     return 0;
 }
 
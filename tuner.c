@@ -0,0 +1,941 @@
+// Tunes the prioritizeShips weights of the scheduler (see SchedulerPolicy in scheduler.c).
+//
+// Every trial runs the real scheduler binary, with a candidate policy, against an
+// emulated validation module playing one workload. Trials run in parallel, one
+// process each, and a perturbation search keeps the policy that services the most
+// ships in the fewest timesteps. The best policy is written as a file scheduler.c
+// reads with --policy.
+//
+// Usage: tuner <scheduler-binary> [--rounds N] [--candidates N] [--jobs N]
+//              [--workloads N] [--docks N] [--ships N] [--seed N]
+//              [--workload <file>]... [--output <file>]
+//
+// Generated workloads are used unless --workload files are given. A workload file is
+//   <numDocks>
+//   <category> <crane capacity>...          (one line per dock)
+//   <numShips> <horizon>
+//   <arrival> <id> <direction> <category> <emergency> <waitingTime> <returnDelay> <numCargo> <cargo>...
+// where a regular incoming ship that is not docked within waitingTime leaves and
+// comes back returnDelay timesteps later, and the run stops after horizon timesteps.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <math.h>
+#include <signal.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include <sys/shm.h>
+
+#define MAX_CARGO_COUNT 200
+#define MAX_NEW_REQUESTS 100
+#define MAX_DOCKS 30
+#define MAX_TUNER_SHIPS 1000
+#define MAX_TUNER_DOCKS 256
+#define MAX_WORKLOADS 32
+#define MAX_JOBS 64
+#define TRIAL_SOLVERS 2
+#define TRIAL_TIMEOUT_SECONDS 120
+#define BATCH_GUESS_BYTES 4000
+
+// Wire formats shared with scheduler.c
+typedef struct ShipRequest {
+    int shipId;
+    int timestep;
+    int category;
+    int direction;
+    int emergency;
+    int waitingTime;
+    int numCargo;
+    int cargo[MAX_CARGO_COUNT];
+} ShipRequest;
+
+typedef struct MessageStruct {
+    long mtype;
+    int timestep;
+    int shipId;
+    int direction;
+    int dockId;
+    int cargoId;
+    int isFinished;
+    union {
+        int numShipRequests;
+        int craneId;
+    };
+} MessageStruct;
+
+typedef struct SolverRequest {
+    long mtype;
+    int dockId;
+    char authStringGuess[100];
+} SolverRequest;
+
+typedef struct SolverResponse {
+    long mtype;
+    int guessIsCorrect;
+} SolverResponse;
+
+typedef struct BatchSolverRequest {
+    long mtype;
+    int dockId;
+    int stringLength;
+    int count;
+    char guesses[BATCH_GUESS_BYTES];
+} BatchSolverRequest;
+
+typedef struct BatchSolverResponse {
+    long mtype;
+    int matchIndex;
+} BatchSolverResponse;
+
+// Policy weights, in the order and with the defaults of SchedulerPolicy
+typedef struct PolicyParam {
+    const char *name;
+    int defaultValue;
+    int minValue;
+    int maxValue;
+} PolicyParam;
+
+PolicyParam policyParams[] = {
+    {"emergencyPriority", 1000000, 0, 100000000},
+    {"overduePriority", 500000, 0, 10000000},
+    {"urgentPriority", 250000, 0, 10000000},
+    {"soonPriority", 100000, 0, 10000000},
+    {"laterPriority", 50000, 0, 10000000},
+    {"urgentWindow", 3, 0, 50},
+    {"soonWindow", 10, 0, 100},
+    {"largeCargoThreshold", 20, 0, MAX_CARGO_COUNT},
+    {"cargoEfficiencyWeight", 10000, 0, 1000000},
+    {"outgoingBasePriority", 10000, 0, 10000000},
+    {"outgoingWaitWeight", 100, 0, 100000},
+    {"cargoDensityWeight", 5000, 0, 1000000},
+    {"lightCargoWeight", 100, 0, 100000},
+    {"arrivalWeight", 10, 0, 100000}
+};
+
+#define NUM_POLICY_PARAMS ((int)(sizeof(policyParams) / sizeof(policyParams[0])))
+
+typedef struct Policy {
+    int values[NUM_POLICY_PARAMS];
+} Policy;
+
+typedef struct WorkloadShip {
+    int id;
+    int direction;
+    int category;
+    int emergency;
+    int waitingTime;
+    int arrival;
+    int returnDelay;
+    int numCargo;
+    int cargo[MAX_CARGO_COUNT];
+} WorkloadShip;
+
+typedef struct Workload {
+    int numDocks;
+    int dockCategory[MAX_TUNER_DOCKS];
+    int craneCapacity[MAX_TUNER_DOCKS][MAX_CARGO_COUNT];
+    int numShips;
+    int horizon;
+    WorkloadShip ships[MAX_TUNER_SHIPS];
+} Workload;
+
+typedef struct TrialResult {
+    int completed;  // the run reached the end without the scheduler dying or timing out
+    int serviced;
+    int timesteps;  // timestep of the last undock, or of the end of the run
+    int missed;     // times a ship left because it was not docked in time
+    int violations; // protocol rules the scheduler broke
+} TrialResult;
+
+typedef struct Score {
+    bool valid;
+    long long serviced;
+    long long timesteps;
+} Score;
+
+char schedulerPath[PATH_MAX];
+Workload *workloads;
+int numWorkloads = 0;
+
+// Small deterministic generator, so a seed always gives the same workload
+unsigned long long rngState;
+
+unsigned int nextRandom() {
+    rngState = rngState * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (unsigned int)(rngState >> 33);
+}
+
+int randomBetween(int low, int high) {
+    return low + (int)(nextRandom() % (unsigned int)(high - low + 1));
+}
+
+double randomGaussian() {
+    double u = (nextRandom() + 1.0) / 4294967297.0;
+    double v = (nextRandom() + 1.0) / 4294967297.0;
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+void generateWorkload(Workload *workload, int numDocks, int numShips, unsigned long long seed) {
+    rngState = seed * 2654435761ULL + 1;
+    workload->numDocks = numDocks;
+    int maxCategory = 1;
+    for (int d = 0; d < numDocks; d++) {
+        workload->dockCategory[d] = randomBetween(1, 6);
+        if (workload->dockCategory[d] > maxCategory) {
+            maxCategory = workload->dockCategory[d];
+        }
+        for (int c = 0; c < workload->dockCategory[d]; c++) {
+            workload->craneCapacity[d][c] = randomBetween(10, 50);
+        }
+    }
+
+    // Ships arrive over the first half of the run; cargo weights fit every crane
+    workload->numShips = numShips;
+    int arrivalSpan = numShips / 2 + 1;
+    workload->horizon = arrivalSpan + 4 * numShips / (numDocks > 0 ? numDocks : 1) + 50;
+    for (int i = 0; i < numShips; i++) {
+        WorkloadShip *ship = &workload->ships[i];
+        ship->id = i + 1;
+        ship->direction = randomBetween(0, 1) ? 1 : -1;
+        ship->category = randomBetween(1, maxCategory);
+        ship->emergency = ship->direction == 1 && randomBetween(0, 9) == 0;
+        ship->waitingTime = (ship->direction == 1 && !ship->emergency) ? randomBetween(3, 20) : 0;
+        ship->arrival = randomBetween(1, arrivalSpan);
+        ship->returnDelay = randomBetween(2, 10);
+        ship->numCargo = randomBetween(1, 3 * ship->category);
+        for (int c = 0; c < ship->numCargo; c++) {
+            ship->cargo[c] = randomBetween(1, 10);
+        }
+    }
+}
+
+void loadWorkload(Workload *workload, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror("Error opening workload file");
+        exit(1);
+    }
+
+    bool ok = fscanf(file, "%d", &workload->numDocks) == 1 &&
+              workload->numDocks > 0 && workload->numDocks <= MAX_TUNER_DOCKS;
+    for (int d = 0; ok && d < workload->numDocks; d++) {
+        ok = fscanf(file, "%d", &workload->dockCategory[d]) == 1 &&
+             workload->dockCategory[d] > 0 && workload->dockCategory[d] <= MAX_CARGO_COUNT;
+        for (int c = 0; ok && c < workload->dockCategory[d]; c++) {
+            ok = fscanf(file, "%d", &workload->craneCapacity[d][c]) == 1;
+        }
+    }
+    ok = ok && fscanf(file, "%d %d", &workload->numShips, &workload->horizon) == 2 &&
+         workload->numShips >= 0 && workload->numShips <= MAX_TUNER_SHIPS;
+    for (int i = 0; ok && i < workload->numShips; i++) {
+        WorkloadShip *ship = &workload->ships[i];
+        ok = fscanf(file, "%d %d %d %d %d %d %d %d", &ship->arrival, &ship->id, &ship->direction,
+                    &ship->category, &ship->emergency, &ship->waitingTime, &ship->returnDelay,
+                    &ship->numCargo) == 8 &&
+             ship->numCargo > 0 && ship->numCargo <= MAX_CARGO_COUNT;
+        for (int c = 0; ok && c < ship->numCargo; c++) {
+            ok = fscanf(file, "%d", &ship->cargo[c]) == 1;
+        }
+    }
+    fclose(file);
+
+    if (!ok) {
+        fprintf(stderr, "Malformed workload file %s\n", path);
+        exit(1);
+    }
+}
+
+// State of one emulated validation run. Each trial is its own process, so plain
+// globals are fine here.
+typedef struct EmulatedShip {
+    int arrival;       // current arrival timestep, pushed back when the ship returns
+    int dock;          // dock it is at, or -1
+    int dockingTimestep;
+    int lastMoveTimestep;
+    int movedCount;
+    bool moved[MAX_CARGO_COUNT];
+    bool announced;    // request already sent for the current arrival
+    bool serviced;
+} EmulatedShip;
+
+Workload *trialWorkload;
+EmulatedShip emulatedShips[MAX_TUNER_SHIPS];
+int dockShip[MAX_TUNER_DOCKS];
+int craneUsedTimestep[MAX_TUNER_DOCKS][MAX_CARGO_COUNT];
+char expectedAuth[MAX_TUNER_DOCKS][100];
+pthread_mutex_t authMutex = PTHREAD_MUTEX_INITIALIZER;
+int mainQueueId;
+int solverQueueIds[TRIAL_SOLVERS];
+int shmId = -1;
+char *sharedMemory;
+int authStringSlots;
+volatile sig_atomic_t trialInterrupted = 0;
+
+void interruptTrial(int signum) {
+    (void)signum;
+    trialInterrupted = 1;
+}
+
+void* singleGuessSolver(void* arg) {
+    int queueId = *(int *)arg;
+    int dockId = -1;
+    SolverRequest request;
+    while (msgrcv(queueId, &request, sizeof(SolverRequest) - sizeof(long), -2, 0) != -1) {
+        if (request.mtype == 1) {
+            dockId = request.dockId;
+            continue;
+        }
+        SolverResponse response;
+        response.mtype = 3;
+        pthread_mutex_lock(&authMutex);
+        response.guessIsCorrect = dockId >= 0 && dockId < trialWorkload->numDocks && expectedAuth[dockId][0] != '\0' &&
+                                  strcmp(expectedAuth[dockId], request.authStringGuess) == 0;
+        pthread_mutex_unlock(&authMutex);
+        msgsnd(queueId, &response, sizeof(SolverResponse) - sizeof(long), 0);
+    }
+    return NULL;
+}
+
+// Answers the scheduler's batch probe and batches, so trials do not spend their time
+// on one message per guess
+void* batchSolver(void* arg) {
+    int queueId = *(int *)arg;
+    BatchSolverRequest request;
+    while (msgrcv(queueId, &request, sizeof(BatchSolverRequest) - sizeof(long), 4, 0) != -1) {
+        BatchSolverResponse response;
+        response.mtype = 5;
+        response.matchIndex = -1;
+        pthread_mutex_lock(&authMutex);
+        if (request.dockId >= 0 && request.dockId < trialWorkload->numDocks) {
+            const char *expected = expectedAuth[request.dockId];
+            int length = (int)strlen(expected);
+            for (int k = 0; length > 0 && length == request.stringLength && k < request.count; k++) {
+                if (memcmp(request.guesses + k * length, expected, length) == 0) {
+                    response.matchIndex = k;
+                    break;
+                }
+            }
+        }
+        pthread_mutex_unlock(&authMutex);
+        msgsnd(queueId, &response, sizeof(BatchSolverResponse) - sizeof(long), 0);
+    }
+    return NULL;
+}
+
+void generateAuthString(int dockId, int length) {
+    const char *edgeChars = "56789";
+    const char *middleChars = "56789.";
+    pthread_mutex_lock(&authMutex);
+    for (int i = 0; i < length; i++) {
+        expectedAuth[dockId][i] = (i == 0 || i == length - 1) ? edgeChars[nextRandom() % 5]
+                                                              : middleChars[nextRandom() % 6];
+    }
+    expectedAuth[dockId][length] = '\0';
+    pthread_mutex_unlock(&authMutex);
+}
+
+// Create the trial's shared memory and queues under keys nobody else is using
+bool createTrialIPC(key_t base) {
+    authStringSlots = trialWorkload->numDocks > MAX_DOCKS ? trialWorkload->numDocks : MAX_DOCKS;
+    size_t shmSize = authStringSlots * 100 + MAX_NEW_REQUESTS * sizeof(ShipRequest);
+    shmId = shmget(base, shmSize, 0666 | IPC_CREAT | IPC_EXCL);
+    if (shmId == -1) {
+        return false;
+    }
+    mainQueueId = msgget(base + 1, 0666 | IPC_CREAT | IPC_EXCL);
+    for (int i = 0; i < TRIAL_SOLVERS; i++) {
+        solverQueueIds[i] = msgget(base + 2 + i, 0666 | IPC_CREAT | IPC_EXCL);
+    }
+    sharedMemory = (char *)shmat(shmId, NULL, 0);
+    return true;
+}
+
+void removeTrialIPC() {
+    if (sharedMemory != NULL && sharedMemory != (char *)-1) {
+        shmdt(sharedMemory);
+    }
+    shmctl(shmId, IPC_RMID, NULL);
+    msgctl(mainQueueId, IPC_RMID, NULL);
+    for (int i = 0; i < TRIAL_SOLVERS; i++) {
+        msgctl(solverQueueIds[i], IPC_RMID, NULL);
+    }
+}
+
+void writeTrialFiles(const char *dir, key_t base, const Policy *policy) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/testcase1", dir);
+    if (mkdir(path, 0755) == -1) {
+        perror("Error creating trial test case directory");
+        exit(1);
+    }
+
+    snprintf(path, sizeof(path), "%s/testcase1/input.txt", dir);
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        perror("Error writing trial input file");
+        exit(1);
+    }
+    fprintf(file, "%d\n%d\n%d\n", (int)base, (int)(base + 1), TRIAL_SOLVERS);
+    for (int i = 0; i < TRIAL_SOLVERS; i++) {
+        fprintf(file, "%d\n", (int)(base + 2 + i));
+    }
+    fprintf(file, "%d\n", trialWorkload->numDocks);
+    for (int d = 0; d < trialWorkload->numDocks; d++) {
+        fprintf(file, "%d", trialWorkload->dockCategory[d]);
+        for (int c = 0; c < trialWorkload->dockCategory[d]; c++) {
+            fprintf(file, " %d", trialWorkload->craneCapacity[d][c]);
+        }
+        fprintf(file, "\n");
+    }
+    fclose(file);
+
+    snprintf(path, sizeof(path), "%s/policy.txt", dir);
+    file = fopen(path, "w");
+    if (file == NULL) {
+        perror("Error writing trial policy file");
+        exit(1);
+    }
+    for (int p = 0; p < NUM_POLICY_PARAMS; p++) {
+        fprintf(file, "%s %d\n", policyParams[p].name, policy->values[p]);
+    }
+    fclose(file);
+}
+
+void removeTrialFiles(const char *dir) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/testcase1/input.txt", dir);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/testcase1", dir);
+    rmdir(path);
+    snprintf(path, sizeof(path), "%s/policy.txt", dir);
+    unlink(path);
+    rmdir(dir);
+}
+
+pid_t startScheduler(const char *dir) {
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("Error forking scheduler");
+        exit(1);
+    }
+    if (pid == 0) {
+        int devNull = open("/dev/null", O_WRONLY);
+        if (chdir(dir) == -1 || devNull == -1) {
+            _exit(127);
+        }
+        dup2(devNull, STDOUT_FILENO);
+        dup2(devNull, STDERR_FILENO);
+        execl(schedulerPath, schedulerPath, "1", "--batch-guesses", "--policy", "policy.txt", (char *)NULL);
+        _exit(127);
+    }
+    return pid;
+}
+
+WorkloadShip *findWorkloadShip(int shipId, int direction) {
+    for (int i = 0; i < trialWorkload->numShips; i++) {
+        if (trialWorkload->ships[i].id == shipId && trialWorkload->ships[i].direction == direction) {
+            return &trialWorkload->ships[i];
+        }
+    }
+    return NULL;
+}
+
+// Check one scheduler message against the rules of the port and apply it. Returns
+// false if the message broke a rule; the emulation cannot follow the scheduler after that.
+bool applySchedulerMessage(MessageStruct *message, int timestep, TrialResult *result) {
+    WorkloadShip *ship = findWorkloadShip(message->shipId, message->direction);
+    int dockId = message->dockId;
+    if (ship == NULL || dockId < 0 || dockId >= trialWorkload->numDocks) {
+        result->violations++;
+        return false;
+    }
+    EmulatedShip *state = &emulatedShips[ship - trialWorkload->ships];
+
+    if (message->mtype == 2) {
+        bool expired = ship->direction == 1 && !ship->emergency && timestep > state->arrival + ship->waitingTime;
+        if (dockShip[dockId] != -1 || state->dock != -1 || state->serviced || state->arrival > timestep ||
+            !state->announced || expired || trialWorkload->dockCategory[dockId] < ship->category) {
+            result->violations++;
+            return false;
+        }
+        dockShip[dockId] = ship - trialWorkload->ships;
+        state->dock = dockId;
+        state->dockingTimestep = timestep;
+        state->lastMoveTimestep = timestep;
+    } else if (message->mtype == 4) {
+        int craneId = message->craneId;
+        int cargoId = message->cargoId;
+        if (state->dock != dockId || timestep <= state->dockingTimestep ||
+            cargoId < 0 || cargoId >= ship->numCargo || state->moved[cargoId] ||
+            craneId < 0 || craneId >= trialWorkload->dockCategory[dockId] ||
+            craneUsedTimestep[dockId][craneId] == timestep ||
+            trialWorkload->craneCapacity[dockId][craneId] < ship->cargo[cargoId]) {
+            result->violations++;
+            return false;
+        }
+        craneUsedTimestep[dockId][craneId] = timestep;
+        state->moved[cargoId] = true;
+        state->movedCount++;
+        state->lastMoveTimestep = timestep;
+        if (state->movedCount == ship->numCargo) {
+            generateAuthString(dockId, timestep - state->dockingTimestep);
+        }
+    } else if (message->mtype == 3) {
+        if (state->dock != dockId || state->movedCount != ship->numCargo ||
+            timestep <= state->lastMoveTimestep ||
+            strncmp(sharedMemory + dockId * 100, expectedAuth[dockId], 100) != 0) {
+            result->violations++;
+            return false;
+        }
+        pthread_mutex_lock(&authMutex);
+        expectedAuth[dockId][0] = '\0';
+        pthread_mutex_unlock(&authMutex);
+        dockShip[dockId] = -1;
+        state->dock = -1;
+        state->serviced = true;
+        result->serviced++;
+        result->timesteps = timestep;
+    }
+    return true;
+}
+
+// Play the workload against a running scheduler until every ship is serviced, or
+// stop it at the horizon. Returns false if the scheduler died or the trial timed out.
+bool emulateValidation(TrialResult *result) {
+    int timestep = 1;
+    while (true) {
+        // The scheduler takes isFinished to mean every ship is done, so a run that
+        // reaches the horizon first is simply cut off
+        if (timestep > trialWorkload->horizon) {
+            result->timesteps = trialWorkload->horizon;
+            return true;
+        }
+
+        MessageStruct update;
+        memset(&update, 0, sizeof(update));
+        update.mtype = 1;
+        update.timestep = timestep;
+        update.isFinished = result->serviced == trialWorkload->numShips;
+
+        // Announce arrivals; anything over the per-timestep limit arrives a timestep later
+        ShipRequest *requests = (ShipRequest *)(sharedMemory + authStringSlots * 100);
+        int count = 0;
+        for (int i = 0; !update.isFinished && i < trialWorkload->numShips; i++) {
+            WorkloadShip *ship = &trialWorkload->ships[i];
+            EmulatedShip *state = &emulatedShips[i];
+            if (state->serviced || state->announced || state->arrival > timestep) {
+                continue;
+            }
+            if (count == MAX_NEW_REQUESTS) {
+                state->arrival = timestep + 1;
+                continue;
+            }
+            ShipRequest *request = &requests[count++];
+            request->shipId = ship->id;
+            request->timestep = timestep;
+            request->category = ship->category;
+            request->direction = ship->direction;
+            request->emergency = ship->emergency;
+            request->waitingTime = ship->waitingTime;
+            request->numCargo = ship->numCargo;
+            memcpy(request->cargo, ship->cargo, ship->numCargo * sizeof(int));
+            state->arrival = timestep;
+            state->announced = true;
+        }
+        update.numShipRequests = count;
+        if (msgsnd(mainQueueId, &update, sizeof(MessageStruct) - sizeof(long), 0) == -1) {
+            return false;
+        }
+
+        while (true) {
+            // Once the scheduler has exited, only take what it left in the queue
+            MessageStruct message;
+            int flags = trialInterrupted ? IPC_NOWAIT : 0;
+            if (msgrcv(mainQueueId, &message, sizeof(MessageStruct) - sizeof(long), -6, flags) == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            if (message.mtype == 1) {
+                if (trialInterrupted) {
+                    return false;
+                }
+                // Our own update, not yet taken by the scheduler
+                msgsnd(mainQueueId, &message, sizeof(MessageStruct) - sizeof(long), 0);
+                usleep(100);
+                continue;
+            }
+            if (message.mtype == 6) {
+                if (update.isFinished) {
+                    return true;
+                }
+                continue;
+            }
+            if (message.mtype == 5) {
+                break;
+            }
+            if (!applySchedulerMessage(&message, timestep, result)) {
+                return true;
+            }
+        }
+
+        // Regular incoming ships not docked in time leave and come back later
+        for (int i = 0; i < trialWorkload->numShips; i++) {
+            WorkloadShip *ship = &trialWorkload->ships[i];
+            EmulatedShip *state = &emulatedShips[i];
+            if (state->announced && !state->serviced && state->dock == -1 && ship->direction == 1 &&
+                !ship->emergency && timestep >= state->arrival + ship->waitingTime) {
+                state->announced = false;
+                state->arrival = timestep + ship->returnDelay;
+                result->missed++;
+            }
+        }
+        timestep++;
+    }
+}
+
+// Runs in its own process: one scheduler, one workload, one policy
+TrialResult runTrial(const Workload *workload, const Policy *policy, unsigned long long seed) {
+    TrialResult result;
+    memset(&result, 0, sizeof(result));
+    trialWorkload = (Workload *)workload;
+    rngState = seed;
+    for (int i = 0; i < workload->numShips; i++) {
+        memset(&emulatedShips[i], 0, sizeof(EmulatedShip));
+        emulatedShips[i].arrival = workload->ships[i].arrival;
+        emulatedShips[i].dock = -1;
+    }
+    for (int d = 0; d < workload->numDocks; d++) {
+        dockShip[d] = -1;
+    }
+
+    key_t base = 0;
+    for (int attempt = 0; attempt < 100; attempt++) {
+        base = 0x54000000 + (key_t)((getpid() * 97 + attempt * 7919) % 0x100000) * 8;
+        if (createTrialIPC(base)) {
+            break;
+        }
+        if (attempt == 99) {
+            perror("Error creating trial IPC objects");
+            exit(1);
+        }
+    }
+
+    char dir[] = "/tmp/tunerXXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        perror("Error creating trial directory");
+        removeTrialIPC();
+        exit(1);
+    }
+    writeTrialFiles(dir, base, policy);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = interruptTrial; // no SA_RESTART, so a blocked msgrcv returns
+    sigaction(SIGCHLD, &action, NULL);
+    sigaction(SIGALRM, &action, NULL);
+    sigaction(SIGINT, &action, NULL);  // still remove the IPC objects when stopped
+    sigaction(SIGTERM, &action, NULL);
+    alarm(TRIAL_TIMEOUT_SECONDS);
+
+    // Solver threads block the trial's signals so they interrupt the validation loop
+    sigset_t trialSignals, previousMask;
+    sigemptyset(&trialSignals);
+    sigaddset(&trialSignals, SIGCHLD);
+    sigaddset(&trialSignals, SIGALRM);
+    sigaddset(&trialSignals, SIGINT);
+    sigaddset(&trialSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &trialSignals, &previousMask);
+    pthread_t solvers[2 * TRIAL_SOLVERS];
+    for (int i = 0; i < TRIAL_SOLVERS; i++) {
+        pthread_create(&solvers[2 * i], NULL, singleGuessSolver, &solverQueueIds[i]);
+        pthread_create(&solvers[2 * i + 1], NULL, batchSolver, &solverQueueIds[i]);
+    }
+    pthread_sigmask(SIG_SETMASK, &previousMask, NULL);
+
+    pid_t scheduler = startScheduler(dir);
+    result.completed = emulateValidation(&result);
+    alarm(0);
+
+    kill(scheduler, SIGKILL);
+    waitpid(scheduler, NULL, 0);
+    removeTrialIPC();
+    for (int i = 0; i < 2 * TRIAL_SOLVERS; i++) {
+        pthread_join(solvers[i], NULL);
+    }
+    removeTrialFiles(dir);
+    return result;
+}
+
+// Evaluate every policy on every workload with up to `jobs` trial processes at a time
+void evaluatePolicies(const Policy *policies, int numPolicies, int jobs, Score *scores) {
+    int numTrials = numPolicies * numWorkloads;
+    pid_t running[MAX_JOBS];
+    int runningTrial[MAX_JOBS];
+    int resultPipes[MAX_JOBS];
+    int active = 0;
+    int nextTrial = 0;
+
+    for (int p = 0; p < numPolicies; p++) {
+        scores[p].valid = true;
+        scores[p].serviced = 0;
+        scores[p].timesteps = 0;
+    }
+
+    while (nextTrial < numTrials || active > 0) {
+        while (active < jobs && nextTrial < numTrials) {
+            int fds[2];
+            if (pipe(fds) == -1) {
+                perror("Error creating trial pipe");
+                exit(1);
+            }
+            pid_t pid = fork();
+            if (pid == -1) {
+                perror("Error forking trial");
+                exit(1);
+            }
+            if (pid == 0) {
+                close(fds[0]);
+                int policyIndex = nextTrial / numWorkloads;
+                int workloadIndex = nextTrial % numWorkloads;
+                TrialResult result = runTrial(&workloads[workloadIndex], &policies[policyIndex],
+                                              (unsigned long long)workloadIndex * 1000003ULL + 17);
+                if (write(fds[1], &result, sizeof(result)) != sizeof(result)) {
+                    _exit(1);
+                }
+                _exit(0);
+            }
+            close(fds[1]);
+            running[active] = pid;
+            runningTrial[active] = nextTrial++;
+            resultPipes[active] = fds[0];
+            active++;
+        }
+
+        int status;
+        pid_t done = wait(&status);
+        if (done == -1) {
+            perror("Error waiting for trial");
+            exit(1);
+        }
+        for (int j = 0; j < active; j++) {
+            if (running[j] != done) {
+                continue;
+            }
+            TrialResult result;
+            memset(&result, 0, sizeof(result));
+            bool gotResult = read(resultPipes[j], &result, sizeof(result)) == sizeof(result);
+            close(resultPipes[j]);
+
+            Score *score = &scores[runningTrial[j] / numWorkloads];
+            if (!gotResult || !result.completed || result.violations > 0) {
+                score->valid = false;
+            }
+            score->serviced += result.serviced;
+            score->timesteps += result.timesteps;
+
+            active--;
+            running[j] = running[active];
+            runningTrial[j] = runningTrial[active];
+            resultPipes[j] = resultPipes[active];
+            break;
+        }
+    }
+}
+
+// More ships serviced wins, then fewer timesteps; runs that broke a rule never win
+bool scoreIsBetter(const Score *a, const Score *b) {
+    if (a->valid != b->valid) {
+        return a->valid;
+    }
+    if (a->serviced != b->serviced) {
+        return a->serviced > b->serviced;
+    }
+    return a->timesteps < b->timesteps;
+}
+
+// Scale a few weights of the best policy by random factors around 1
+void perturbPolicy(const Policy *best, Policy *candidate, double spread) {
+    *candidate = *best;
+    int changed = 0;
+    while (changed == 0) {
+        for (int p = 0; p < NUM_POLICY_PARAMS; p++) {
+            if (nextRandom() % 3 != 0) {
+                continue;
+            }
+            PolicyParam *param = &policyParams[p];
+            double value = best->values[p];
+            if (value == 0) {
+                value = param->defaultValue > 0 ? param->defaultValue * spread : 1;
+            }
+            value *= exp(randomGaussian() * spread);
+            if (value < param->minValue) {
+                value = param->minValue;
+            }
+            if (value > param->maxValue) {
+                value = param->maxValue;
+            }
+            candidate->values[p] = (int)(value + 0.5);
+            changed++;
+        }
+    }
+}
+
+void writePolicy(const char *path, const Policy *policy, const Score *score) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        perror("Error writing policy file");
+        exit(1);
+    }
+    fprintf(file, "# Tuned on %d workloads: %lld ships serviced in %lld timesteps\n",
+            numWorkloads, score->serviced, score->timesteps);
+    for (int p = 0; p < NUM_POLICY_PARAMS; p++) {
+        fprintf(file, "%s %d\n", policyParams[p].name, policy->values[p]);
+    }
+    fclose(file);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <scheduler-binary> [--rounds N] [--candidates N] [--jobs N] "
+                        "[--workloads N] [--docks N] [--ships N] [--seed N] [--workload <file>]... "
+                        "[--output <file>]\n", argv[0]);
+        return 1;
+    }
+    if (realpath(argv[1], schedulerPath) == NULL) {
+        perror("Error resolving scheduler binary");
+        return 1;
+    }
+
+    int rounds = 10;
+    long onlineCpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int jobs = onlineCpus > 0 ? (int)onlineCpus : 1;
+    int candidates = 0;
+    int generated = 4;
+    int numDocks = 10;
+    int numShips = 60;
+    unsigned long long seed = 1;
+    const char *outputPath = "tuned_policy.txt";
+    const char *workloadPaths[MAX_WORKLOADS];
+    int numWorkloadPaths = 0;
+
+    for (int i = 2; i < argc; i++) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return 1;
+        }
+        const char *option = argv[i];
+        const char *value = argv[++i];
+        if (strcmp(option, "--rounds") == 0) {
+            rounds = atoi(value);
+        } else if (strcmp(option, "--candidates") == 0) {
+            candidates = atoi(value);
+        } else if (strcmp(option, "--jobs") == 0) {
+            jobs = atoi(value);
+        } else if (strcmp(option, "--workloads") == 0) {
+            generated = atoi(value);
+        } else if (strcmp(option, "--docks") == 0) {
+            numDocks = atoi(value);
+        } else if (strcmp(option, "--ships") == 0) {
+            numShips = atoi(value);
+        } else if (strcmp(option, "--seed") == 0) {
+            seed = strtoull(value, NULL, 10);
+        } else if (strcmp(option, "--workload") == 0 && numWorkloadPaths < MAX_WORKLOADS) {
+            workloadPaths[numWorkloadPaths++] = value;
+        } else if (strcmp(option, "--output") == 0) {
+            outputPath = value;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", option);
+            return 1;
+        }
+    }
+    if (jobs < 1) {
+        jobs = 1;
+    }
+    if (jobs > MAX_JOBS) {
+        jobs = MAX_JOBS;
+    }
+    if (candidates < 1) {
+        candidates = 2 * jobs;
+    }
+    if (generated < 1 || generated > MAX_WORKLOADS || numDocks < 1 || numDocks > MAX_TUNER_DOCKS ||
+        numShips < 1 || numShips > MAX_TUNER_SHIPS) {
+        fprintf(stderr, "Workloads must be 1-%d, docks 1-%d and ships 1-%d\n",
+                MAX_WORKLOADS, MAX_TUNER_DOCKS, MAX_TUNER_SHIPS);
+        return 1;
+    }
+
+    numWorkloads = numWorkloadPaths > 0 ? numWorkloadPaths : generated;
+    workloads = (Workload *)malloc(numWorkloads * sizeof(Workload));
+    if (workloads == NULL) {
+        perror("Memory allocation failed for workloads");
+        return 1;
+    }
+    for (int w = 0; w < numWorkloads; w++) {
+        if (numWorkloadPaths > 0) {
+            loadWorkload(&workloads[w], workloadPaths[w]);
+        } else {
+            generateWorkload(&workloads[w], numDocks, numShips, seed + w);
+        }
+    }
+
+    Policy *policies = (Policy *)malloc(candidates * sizeof(Policy));
+    Score *scores = (Score *)malloc(candidates * sizeof(Score));
+    if (policies == NULL || scores == NULL) {
+        perror("Memory allocation failed for candidate policies");
+        return 1;
+    }
+
+    Policy best;
+    Score bestScore;
+    for (int p = 0; p < NUM_POLICY_PARAMS; p++) {
+        best.values[p] = policyParams[p].defaultValue;
+    }
+    evaluatePolicies(&best, 1, jobs, &bestScore);
+    printf("Default policy: %lld ships serviced in %lld timesteps%s\n",
+           bestScore.serviced, bestScore.timesteps, bestScore.valid ? "" : " (invalid run)");
+
+    rngState = seed * 0x9e3779b97f4a7c15ULL + 7;
+    double spread = 1.0;
+    for (int round = 1; round <= rounds; round++) {
+        for (int c = 0; c < candidates; c++) {
+            perturbPolicy(&best, &policies[c], spread);
+        }
+        evaluatePolicies(policies, candidates, jobs, scores);
+
+        int winner = -1;
+        for (int c = 0; c < candidates; c++) {
+            if (scoreIsBetter(&scores[c], winner == -1 ? &bestScore : &scores[winner])) {
+                winner = c;
+            }
+        }
+        if (winner != -1) {
+            best = policies[winner];
+            bestScore = scores[winner];
+        } else {
+            // Nothing better nearby; look closer to the current best
+            spread *= 0.7;
+        }
+        printf("Round %d: best %lld ships serviced in %lld timesteps\n",
+               round, bestScore.serviced, bestScore.timesteps);
+    }
+
+    writePolicy(outputPath, &best, &bestScore);
+    printf("Wrote %s\n", outputPath);
+
+    free(policies);
+    free(scores);
+    free(workloads);
+    return 0;
+}